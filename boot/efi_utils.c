@@ -10,6 +10,17 @@ void *memset(void *s, int c, unsigned long n) {
     return s;
 }
 
+static BOOLEAN guid_equal(const EFI_GUID *a, const EFI_GUID *b) {
+    const UINT8 *pa = (const UINT8 *)a;
+    const UINT8 *pb = (const UINT8 *)b;
+    for (UINTN i = 0; i < sizeof(EFI_GUID); i++) {
+        if (pa[i] != pb[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 #ifndef EFI_PAGE_SIZE
 #define EFI_PAGE_SIZE 4096
 #endif
@@ -392,6 +403,8 @@ EFI_STATUS boot_kernel(void)
         uint64_t memory_map_addr;
         uint64_t memory_map_size;
         uint64_t descriptor_size;
+
+        uint64_t acpi_rsdp;
     } boot_params_t;
     #pragma pack(pop)
 
@@ -649,6 +662,27 @@ EFI_STATUS boot_kernel(void)
         print_string(L"[!] Using default VGA framebuffer\r\n");
     }
 
+    // 查找 ACPI RSDP，优先 ACPI 2.0 (XSDT)
+    EFI_GUID acpi20_guid = EFI_ACPI_20_TABLE_GUID;
+    EFI_GUID acpi10_guid = EFI_ACPI_10_TABLE_GUID;
+    EFI_CONFIGURATION_TABLE *config = (EFI_CONFIGURATION_TABLE *)gST->ConfigurationTable;
+    for (UINTN i = 0; i < gST->NumberOfTableEntries; i++)
+    {
+        if (guid_equal(&config[i].VendorGuid, &acpi20_guid))
+        {
+            params->acpi_rsdp = (uint64_t)config[i].VendorTable;
+            break;
+        }
+        if (guid_equal(&config[i].VendorGuid, &acpi10_guid))
+        {
+            params->acpi_rsdp = (uint64_t)config[i].VendorTable;
+        }
+    }
+    if (params->acpi_rsdp)
+    {
+        print_string(L"[OK] ACPI RSDP found\r\n");
+    }
+
     EFI_MEMORY_DESCRIPTOR *memory_map = NULL;
     UINTN memory_map_size = 0;
     UINTN map_key;
@@ -0,0 +1,98 @@
+// acpi.h - ACPI 表查找与 NUMA 相关表结构 (SRAT / SLIT)
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#pragma pack(push, 1)
+typedef struct {
+    char signature[8];          // "RSD PTR "
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;           // 0: ACPI 1.0，>= 2: 含 XSDT 地址
+    uint32_t rsdt_addr;
+    uint32_t length;
+    uint64_t xsdt_addr;
+    uint8_t ext_checksum;
+    uint8_t reserved[3];
+} acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} acpi_sdt_header_t;
+
+// SRAT: 系统资源亲和表
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t reserved1;
+    uint64_t reserved2;
+} acpi_srat_t;
+
+#define SRAT_TYPE_CPU_AFFINITY      0
+#define SRAT_TYPE_MEMORY_AFFINITY   1
+#define SRAT_TYPE_X2APIC_AFFINITY   2
+
+#define SRAT_FLAG_ENABLED           0x1
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} acpi_srat_entry_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    uint8_t domain_lo;
+    uint8_t apic_id;
+    uint32_t flags;
+    uint8_t sapic_eid;
+    uint8_t domain_hi[3];
+    uint32_t clock_domain;
+} acpi_srat_cpu_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    uint32_t domain;
+    uint16_t reserved1;
+    uint64_t base;
+    uint64_t size;
+    uint32_t reserved2;
+    uint32_t flags;
+    uint64_t reserved3;
+} acpi_srat_mem_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    uint16_t reserved1;
+    uint32_t domain;
+    uint32_t x2apic_id;
+    uint32_t flags;
+    uint32_t clock_domain;
+    uint32_t reserved2;
+} acpi_srat_x2apic_t;
+
+// SLIT: 节点间相对距离矩阵，本地距离为 10
+typedef struct {
+    acpi_sdt_header_t header;
+    uint64_t locality_count;
+    uint8_t entries[];
+} acpi_slit_t;
+#pragma pack(pop)
+
+void acpi_init(uint64_t rsdp_addr);
+bool acpi_available(void);
+// 按 4 字节签名查找表，校验和错误或不存在时返回 NULL
+acpi_sdt_header_t* acpi_find_table(const char* signature);
+
+#endif // ACPI_H
@@ -0,0 +1,74 @@
+// cpu.h - 每 CPU 数据、中断开关与自旋锁
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_CPUS    8
+
+// 当前 CPU 编号。尚未启动 AP，只有 BSP 在运行，恒为 0；
+// SMP 启动后改为从每 CPU 数据中读取
+static inline uint32_t cpu_current_id(void) {
+    return 0;
+}
+
+static inline uint64_t cpu_irq_save(void) {
+    uint64_t rflags;
+    asm volatile("pushfq; pop %0; cli" : "=r"(rflags) : : "memory");
+    return rflags;
+}
+
+static inline void cpu_irq_restore(uint64_t rflags) {
+    if (rflags & 0x200) {
+        asm volatile("sti" : : : "memory");
+    }
+}
+
+static inline uint64_t cpu_read_cr3(void) {
+    uint64_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+static inline uint64_t cpu_read_msr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void cpu_write_msr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)) : "memory");
+}
+
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT {0}
+
+static inline void spin_lock(spinlock_t* lock) {
+    while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        while (lock->locked) {
+            asm volatile("pause");
+        }
+    }
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+// 关中断并加锁，防止同一 CPU 上的中断处理程序重入
+static inline uint64_t spin_lock_irqsave(spinlock_t* lock) {
+    uint64_t flags = cpu_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint64_t flags) {
+    spin_unlock(lock);
+    cpu_irq_restore(flags);
+}
+
+#endif // CPU_H
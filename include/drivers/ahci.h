@@ -0,0 +1,69 @@
+#ifndef AHCI_H
+#define AHCI_H
+
+#include <stdint.h>
+
+// HBA 通用寄存器 (相对 ABAR)
+#define AHCI_CAP        0x00
+#define AHCI_GHC        0x04
+#define AHCI_IS         0x08
+#define AHCI_PI         0x0C
+#define AHCI_VS         0x10
+
+#define AHCI_CAP_SNCQ   (1U << 30)  // 支持原生命令队列
+#define AHCI_CAP_S64A   (1U << 31)  // 支持 64 位地址
+#define AHCI_GHC_AE     (1U << 31)  // AHCI 使能
+
+// 端口寄存器 (相对 0x100 + port * 0x80)
+#define AHCI_PORT_BASE(p)   (0x100 + (p) * 0x80)
+#define AHCI_PxCLB      0x00
+#define AHCI_PxCLBU     0x04
+#define AHCI_PxFB       0x08
+#define AHCI_PxFBU      0x0C
+#define AHCI_PxIS       0x10
+#define AHCI_PxIE       0x14
+#define AHCI_PxCMD      0x18
+#define AHCI_PxTFD      0x20
+#define AHCI_PxSIG      0x24
+#define AHCI_PxSSTS     0x28
+#define AHCI_PxSCTL     0x2C
+#define AHCI_PxSERR     0x30
+#define AHCI_PxSACT     0x34
+#define AHCI_PxCI       0x38
+
+#define AHCI_PxCMD_ST   (1U << 0)   // 启动命令引擎
+#define AHCI_PxCMD_FRE  (1U << 4)   // 启动 FIS 接收
+#define AHCI_PxCMD_FR   (1U << 14)  // FIS 接收运行中
+#define AHCI_PxCMD_CR   (1U << 15)  // 命令列表运行中
+
+#define AHCI_PxIS_TFES  (1U << 30)  // 任务文件错误
+
+#define AHCI_TFD_ERR    0x01
+#define AHCI_TFD_DRQ    0x08
+#define AHCI_TFD_BSY    0x80
+
+#define AHCI_SIG_ATA    0x00000101
+
+// FIS 类型
+#define FIS_TYPE_REG_H2D    0x27
+
+// ATA 命令
+#define ATA_CMD_READ_DMA_EXT    0x25
+#define ATA_CMD_WRITE_DMA_EXT   0x35
+#define ATA_CMD_READ_FPDMA      0x60    // NCQ 读
+#define ATA_CMD_WRITE_FPDMA     0x61    // NCQ 写
+#define ATA_CMD_FLUSH_EXT       0xEA
+#define ATA_CMD_IDENTIFY        0xEC
+
+#define AHCI_MAX_SLOTS      32
+#define AHCI_PRDT_ENTRIES   8
+#define AHCI_PRD_MAX_BYTES  (4 * 1024 * 1024)
+#define AHCI_CHUNK_SECTORS  32      // 大请求拆分成多个并发 NCQ 命令
+#define AHCI_MAX_DMA_SECTORS 8192   // 非 NCQ 时单条命令的扇区数上限
+
+int ahci_init(void);
+int ahci_present(void);
+int ahci_read_sectors(uint64_t lba, uint32_t num_sectors, void* buffer);
+int ahci_write_sectors(uint64_t lba, uint32_t num_sectors, void* buffer);
+
+#endif // AHCI_H
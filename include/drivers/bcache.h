@@ -0,0 +1,30 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+
+// 块缓存配置
+#define BCACHE_SECTOR_SIZE  512
+#define BCACHE_ENTRIES      128     // 缓存扇区数 (64KB)
+#define BCACHE_HASH_BUCKETS 64      // 必须为2的幂
+
+// 缓存统计信息
+typedef struct {
+    uint32_t hits;          // 命中次数
+    uint32_t misses;        // 未命中次数
+    uint32_t evictions;     // 淘汰次数
+    uint32_t writebacks;    // 回写扇区数
+    uint32_t dirty;         // 当前脏扇区数
+    uint32_t cached;        // 当前有效扇区数
+} bcache_stats_t;
+
+void bcache_init(void);
+int bcache_read(uint32_t lba, void* buffer);
+int bcache_write(uint32_t lba, const void* buffer);
+int bcache_sync(void);
+void bcache_invalidate(void);
+int bcache_flush_range(uint32_t lba, uint32_t count);
+void bcache_invalidate_range(uint32_t lba, uint32_t count);
+void bcache_get_stats(bcache_stats_t* stats);
+
+#endif // BCACHE_H
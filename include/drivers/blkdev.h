@@ -0,0 +1,82 @@
+#ifndef BLKDEV_H
+#define BLKDEV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 块设备层：设备注册、异步 bio 提交、电梯排序与相邻请求合并
+#define BLKDEV_MAX_DEVICES  4
+#define BLK_SECTOR_SIZE     512
+#define BLK_MAX_SECTORS     128     // 单个合并请求的最大扇区数 (64KB)
+#define BLK_QUEUE_MAX       32      // 队列积压到此数量时自动派发
+#define BLK_MAX_REQUESTS    32      // 同时在途的合并请求数
+#define BLK_BOUNCE_BUFFERS  4       // 缓冲区不连续的合并请求使用的中转缓冲数
+
+// 底层驱动接口
+typedef int (*blk_io_func)(uint64_t lba, uint32_t num_sectors, void* buffer);
+typedef void (*blk_done_t)(void* ctx, int status);
+
+typedef struct {
+    blk_io_func read;
+    blk_io_func write;
+    // 可选的异步接口：queue 只入队，kick 一次性通知设备，poll 回收完成
+    int (*queue)(uint64_t lba, uint32_t num_sectors, void* buffer, bool write,
+                 blk_done_t done, void* ctx);
+    void (*kick)(void);
+    void (*poll)(void);
+    // 可选：请求超时后复位设备，所有在途请求须以失败回调结束且不再访问缓冲区
+    void (*reset)(void);
+} blkdev_ops_t;
+
+typedef struct bio bio_t;
+typedef void (*bio_end_t)(bio_t* bio);
+
+struct bio {
+    uint64_t lba;
+    uint32_t count;         // 扇区数
+    void*    buffer;
+    bool     write;
+    volatile bool done;
+    int      status;        // 0 成功，-1 失败
+    bio_end_t end_io;       // 完成回调，可为 NULL
+    void*    private_data;
+    bio_t*   next;          // 队列 / 合并链
+};
+
+typedef struct {
+    uint32_t submitted;     // 提交的 bio 数
+    uint32_t merged;        // 被合并进其他请求的 bio 数
+    uint32_t dispatched;    // 下发给驱动的请求数
+    uint32_t bounced;       // 使用中转缓冲的请求数
+    uint32_t errors;
+} blkdev_stats_t;
+
+typedef struct blkdev {
+    char name[16];
+    blkdev_ops_t ops;
+    bio_t* queue;           // 按 LBA 升序排列的待派发 bio
+    uint32_t queued;
+    volatile uint32_t inflight;
+    blkdev_stats_t stats;
+} blkdev_t;
+
+void blkdev_init(void);
+blkdev_t* blkdev_register(const char* name, const blkdev_ops_t* ops);
+blkdev_t* blkdev_get(const char* name);
+blkdev_t* blkdev_get_default(void);
+void blkdev_set_default(blkdev_t* dev);
+int blkdev_count(void);
+blkdev_t* blkdev_get_index(int index);
+
+void bio_init(bio_t* bio, uint64_t lba, uint32_t count, void* buffer, bool write);
+// bio 不得超过 BLK_MAX_SECTORS 扇区，更大的传输用 blk_rw
+void submit_bio(blkdev_t* dev, bio_t* bio);
+void blk_unplug(blkdev_t* dev);
+int blk_wait(blkdev_t* dev, bio_t* bio);
+void blk_drain(blkdev_t* dev);
+void blk_abort(blkdev_t* dev);
+
+// 同步读写：提交后立即派发并等待完成
+int blk_rw(blkdev_t* dev, uint64_t lba, uint32_t count, void* buffer, bool write);
+
+#endif // BLKDEV_H
@@ -0,0 +1,12 @@
+#ifndef DISK_H
+#define DISK_H
+
+#include <stdint.h>
+
+// 磁盘访问统一入口：探测控制器并注册到块设备层，读写走默认块设备
+void disk_init(void);
+int disk_read_sectors(uint32_t lba, uint8_t num_sectors, void* buffer);
+int disk_write_sectors(uint32_t lba, uint8_t num_sectors, void* buffer);
+const char* disk_get_driver_name(void);
+
+#endif // DISK_H
@@ -56,6 +56,15 @@ typedef struct __attribute__((packed)) {
     uint32_t    file_size;
 } fat32_dir_entry_t;
 
+// Contiguous run of clusters in a file's chain
+typedef struct {
+    uint32_t    file_cluster;          // Index of the first cluster within the file
+    uint32_t    start_cluster;         // First physical cluster of the run
+    uint32_t    length;                // Number of clusters in the run
+} fat32_extent_t;
+
+#define FAT32_MAX_EXTENTS 16
+
 // FAT32 File/Directory Handle
 typedef struct {
     uint32_t    first_cluster;         // First cluster of file/directory
@@ -71,6 +80,16 @@ typedef struct {
 
     uint32_t    dir_sector;
     uint32_t    dir_offset;
+
+    // Extent map, built lazily as the cluster chain is walked
+    fat32_extent_t extents[FAT32_MAX_EXTENTS];
+    uint32_t    extent_count;
+
+    // Readahead state (in page-cache pages)
+    uint32_t    ra_prev;               // Last page read through this handle
+    uint32_t    ra_start;              // First page of the current readahead window
+    uint32_t    ra_size;               // Window size, doubles on sequential access
+    uint32_t    ra_trigger;            // Reading this page reads the next window (synchronously)
 } fat32_handle_t;
 
 typedef struct {
@@ -109,7 +128,8 @@ typedef enum {
 
 bool fat32_init(uint32_t partition_start);
 bool fat32_mount(uint32_t partition_start);
-void fat32_umount(void);
+bool fat32_umount(void);
+bool fat32_sync(void);
 bool fat32_format(uint32_t partition_start, const char* volume_label);
 bool fat32_check(void);
 uint32_t fat32_get_free_space(void);
@@ -0,0 +1,48 @@
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 文件页缓存：按 (文件, 页号) 缓存 4KB 文件数据页，同一文件的所有句柄共享。
+// 缓存页总是干净的：写路径先落到块缓存，再使对应页失效
+#define PCACHE_PAGE_SIZE     4096
+#define PCACHE_PAGES         256     // 缓存页数 (1MB)，页面首次使用时才从 PMM 分配
+#define PCACHE_HASH_BUCKETS  64      // 必须为2的幂
+
+typedef struct pcache_page {
+    uint32_t file;          // 文件标识 (FAT32 使用首簇号)
+    uint32_t index;         // 文件内页号
+    uint32_t valid;         // 已读入的字节数，0 表示尚未填充
+    bool     cached;        // 已挂入哈希表
+    struct pcache_page* hash_next;
+    struct pcache_page* lru_prev;
+    struct pcache_page* lru_next;
+    uint8_t* data;          // PMM 页
+} pcache_page_t;
+
+typedef struct {
+    uint32_t hits;          // 命中次数
+    uint32_t misses;        // 未命中次数
+    uint32_t fills;         // 从磁盘读入的页数 (含预读)
+    uint32_t evictions;     // 淘汰次数
+    uint32_t cached;        // 当前缓存页数
+} pcache_stats_t;
+
+void pcache_init(void);
+// 查找至少含 min_valid 字节有效数据的页，计入命中/未命中
+pcache_page_t* pcache_lookup(uint32_t file, uint32_t index, uint32_t min_valid);
+// 取得 (file, index) 的缓存页，不存在时淘汰最久未使用的页；新页 valid 为 0
+pcache_page_t* pcache_grab(uint32_t file, uint32_t index);
+// 填充完成后调用，记录有效字节数
+void pcache_fill_done(pcache_page_t* page, uint32_t valid);
+// 丢弃一页 (填充失败时)
+void pcache_drop(pcache_page_t* page);
+// 永久移出缓存且不再复用 (设备超时后可能仍在向该页 DMA)
+void pcache_retire(pcache_page_t* page);
+void pcache_invalidate_file(uint32_t file);
+void pcache_invalidate_range(uint32_t file, uint32_t first, uint32_t count);
+void pcache_invalidate_all(void);
+void pcache_get_stats(pcache_stats_t* stats);
+
+#endif // PCACHE_H
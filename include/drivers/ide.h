@@ -29,6 +29,38 @@
 #define IDE_CMD_READ    0x20    // 读扇区
 #define IDE_CMD_WRITE   0x30    // 写扇区
 #define IDE_CMD_IDENT   0xEC    // 识别设备
+#define IDE_CMD_READ_DMA  0xC8  // DMA 读扇区
+#define IDE_CMD_WRITE_DMA 0xCA  // DMA 写扇区
+#define IDE_CMD_FLUSH   0xE7    // 刷新写缓存
+#define IDE_CMD_READ_EXT            0x24    // 48 位读扇区
+#define IDE_CMD_WRITE_EXT           0x34    // 48 位写扇区
+#define IDE_CMD_READ_DMA_EXT        0x25
+#define IDE_CMD_WRITE_DMA_EXT       0x35
+#define IDE_CMD_READ_MULTIPLE       0xC4    // 每个 DRQ 块传输多个扇区
+#define IDE_CMD_WRITE_MULTIPLE      0xC5
+#define IDE_CMD_READ_MULTIPLE_EXT   0x29
+#define IDE_CMD_WRITE_MULTIPLE_EXT  0x39
+#define IDE_CMD_SET_MULTIPLE        0xC6
+#define IDE_CMD_FLUSH_EXT           0xEA
+
+#define IDE_LBA28_LIMIT         0x10000000ULL
+#define IDE_LBA48_MAX_SECTORS   65536   // 扇区数寄存器写 0 表示 65536
+#define IDE_DMA_MAX_SECTORS     8192    // 单条 DMA 命令 4MB，PRD 表一页放得下
+
+// 总线主控 DMA 寄存器 (相对 PCI BAR4)
+#define IDE_BM_COMMAND  0x00
+#define IDE_BM_STATUS   0x02
+#define IDE_BM_PRDT     0x04
+
+#define IDE_BM_CMD_START     0x01   // 启动传输
+#define IDE_BM_CMD_READ      0x08   // 方向：设备写入内存
+#define IDE_BM_STATUS_ACTIVE 0x01
+#define IDE_BM_STATUS_ERR    0x02
+#define IDE_BM_STATUS_IRQ    0x04
+
+// 主通道中断 (IRQ14 -> 向量 46)
+#define IDE_IRQ         14
+#define IDE_IRQ_VECTOR  46
 
 // 设备选择
 #define IDE_MASTER      0xE0    // 主设备
@@ -49,9 +81,13 @@
 #define IDE_ERR_BBK     0x80    // 坏块检测
 
 void ide_init(void);
+int ide_dma_init(void);
 int ide_read_sectors(uint32_t lba, uint8_t num_sectors, void* buffer);
 int ide_write_sectors(uint32_t lba, uint8_t num_sectors, void* buffer);
+int ide_read_sectors_ext(uint64_t lba, uint32_t num_sectors, void* buffer);
+int ide_write_sectors_ext(uint64_t lba, uint32_t num_sectors, void* buffer);
 void ide_identify(void);
+uint64_t ide_get_total_sectors(void);
 uint8_t ide_get_status(void);
 void ide_wait_not_busy(void);
 int ide_wait_drq(void);
@@ -0,0 +1,53 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// PCI 配置空间端口
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+// 配置空间寄存器偏移
+#define PCI_VENDOR_ID       0x00
+#define PCI_DEVICE_ID       0x02
+#define PCI_COMMAND         0x04
+#define PCI_STATUS          0x06
+#define PCI_PROG_IF         0x09
+#define PCI_SUBCLASS        0x0A
+#define PCI_CLASS           0x0B
+#define PCI_HEADER_TYPE     0x0E
+#define PCI_BAR0            0x10
+#define PCI_BAR4            0x20
+#define PCI_BAR5            0x24
+#define PCI_INTERRUPT_LINE  0x3C
+
+// 命令寄存器位
+#define PCI_CMD_IO_SPACE    0x0001
+#define PCI_CMD_MEM_SPACE   0x0002
+#define PCI_CMD_BUS_MASTER  0x0004
+#define PCI_CMD_INTX_DISABLE 0x0400
+
+typedef struct {
+    uint8_t  bus;
+    uint8_t  device;
+    uint8_t  function;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t  class_code;
+    uint8_t  subclass;
+    uint8_t  prog_if;
+} pci_device_t;
+
+uint32_t pci_config_read32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset);
+uint16_t pci_config_read16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset);
+uint8_t pci_config_read8(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset);
+void pci_config_write32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset, uint32_t value);
+void pci_config_write16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset, uint16_t value);
+
+bool pci_find_class(uint8_t class_code, uint8_t subclass, pci_device_t* out);
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t* out);
+uint32_t pci_read_bar(const pci_device_t* pdev, int bar);
+void pci_enable_bus_master(const pci_device_t* pdev);
+
+#endif // PCI_H
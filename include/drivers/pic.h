@@ -12,6 +12,8 @@
 #define ICW1_INIT     0x10      // 初始化标志
 
 void pic_remap(uint8_t offset1, uint8_t offset2);
+void pic_enable_irq(uint8_t irq);
+void pic_send_eoi(uint8_t irq);
 
 
 #endif // PIC_H
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 过渡版 (legacy) virtio-blk PCI 设备
+#define VIRTIO_PCI_VENDOR       0x1AF4
+#define VIRTIO_PCI_DEVICE_BLK   0x1001
+
+// legacy virtio-pci I/O 寄存器 (相对 BAR0)
+#define VIRTIO_PCI_HOST_FEATURES    0x00
+#define VIRTIO_PCI_GUEST_FEATURES   0x04
+#define VIRTIO_PCI_QUEUE_PFN        0x08
+#define VIRTIO_PCI_QUEUE_SIZE       0x0C
+#define VIRTIO_PCI_QUEUE_SEL        0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY     0x10
+#define VIRTIO_PCI_STATUS           0x12
+#define VIRTIO_PCI_ISR              0x13
+#define VIRTIO_PCI_CONFIG           0x14
+
+// 设备状态位
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FAILED        0x80
+
+// 描述符标志
+#define VIRTQ_DESC_F_NEXT       1
+#define VIRTQ_DESC_F_WRITE      2
+
+// 请求类型与状态
+#define VIRTIO_BLK_T_IN         0
+#define VIRTIO_BLK_T_OUT        1
+#define VIRTIO_BLK_T_FLUSH      4
+#define VIRTIO_BLK_S_OK         0
+
+#define VIRTIO_BLK_MAX_REQS     64      // 每个请求占 3 个描述符
+
+// 异步请求完成回调，status 为 0 表示成功
+typedef void (*virtio_blk_done_t)(void* ctx, int status);
+
+int virtio_blk_init(void);
+bool virtio_blk_present(void);
+
+// 批量提交：queue 只把请求放入可用环，kick 一次性通知设备
+int virtio_blk_queue(uint64_t lba, uint32_t num_sectors, void* buffer, bool write,
+                     virtio_blk_done_t done, void* ctx);
+void virtio_blk_kick(void);
+void virtio_blk_poll(void);
+// 复位设备：停止一切 DMA，未完成的请求以失败结束，随后重新建立队列
+void virtio_blk_reset(void);
+
+int virtio_blk_read_sectors(uint64_t lba, uint32_t num_sectors, void* buffer);
+int virtio_blk_write_sectors(uint64_t lba, uint32_t num_sectors, void* buffer);
+
+#endif // VIRTIO_BLK_H
@@ -496,6 +496,17 @@ struct _EFI_SYSTEM_TABLE {
     VOID *ConfigurationTable;
 };
 
+// 配置表项 (SystemTable->ConfigurationTable 数组元素)
+typedef struct {
+    EFI_GUID VendorGuid;
+    VOID *VendorTable;
+} EFI_CONFIGURATION_TABLE;
+
+#define EFI_ACPI_20_TABLE_GUID \
+    {0x8868e871, 0xe4f1, 0x11d3, {0xbc, 0x22, 0x00, 0x80, 0xc7, 0x3c, 0x88, 0x81}}
+#define EFI_ACPI_10_TABLE_GUID \
+    {0xeb9d2d30, 0x2d88, 0x11d3, {0x9a, 0x16, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d}}
+
 // 应用程序入口点类型
 typedef EFI_STATUS (EFIAPI *EFI_IMAGE_ENTRY_POINT)(
     EFI_HANDLE ImageHandle,
@@ -34,5 +34,6 @@ typedef void (*interrupt_handler_t)(interrupt_frame_t*);
 void idt_init();
 void register_interrupt_handler(uint8_t n, interrupt_handler_t handler);
 void send_eoi(int int_no);
+void idt_dump_exception(interrupt_frame_t* frame);
 
 #endif // IDT_H
\ No newline at end of file
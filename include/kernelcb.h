@@ -17,6 +17,8 @@ typedef struct {
     uint64_t memory_map_addr;
     uint64_t memory_map_size;
     uint64_t descriptor_size;
+
+    uint64_t acpi_rsdp;
 } boot_params_t;
 #pragma pack(pop)
 
@@ -4,14 +4,50 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
-#define HEAP_BASE_ADDR 0x2000000
-#define HEAP_SIZE (32 * 1024 * 1024)
+// 内核堆：按尺寸类划分的 slab 分配器，底层按页向 PMM 申请
+#define MEM_CLASS_COUNT     7       // 16, 32, ..., 1024 字节
+#define MEM_MAX_SMALL_SIZE  1024    // 更大的请求直接按页分配
+#define MEM_MAG_SIZE        32      // 每 CPU 每尺寸类弹匣容量
+#define MEM_MAG_BATCH       (MEM_MAG_SIZE / 2)  // 与 slab 层批量交换的对象数
+#define MEM_HEAP_EXTENTS    128     // 按需分页堆空闲虚拟区间表容量
+
+typedef struct {
+    uint32_t size;          // 对象大小 (大对象类为 0)
+    uint32_t allocs;        // 累计分配次数
+    uint32_t frees;         // 累计释放次数
+    uint32_t in_use;        // 当前在用对象数
+    uint32_t cached;        // 缓存在每 CPU 弹匣中的空闲对象数
+    uint32_t slabs;         // 占用页数
+} mem_class_stats_t;
+
+// 分配跟踪记录
+#define MEM_TRACE_ENTRIES   1024    // 必须为2的幂
+#define MEM_TRACE_ALLOC     1
+#define MEM_TRACE_FREE      2
+
+typedef struct {
+    uint64_t seq;           // 全局序号 + 1，0 表示记录无效或正在写入
+    uint64_t tick;          // timer_get_ticks()
+    uint64_t caller;        // 调用者返回地址
+    uint64_t ptr;
+    uint32_t size;
+    uint16_t op;            // MEM_TRACE_ALLOC / MEM_TRACE_FREE
+    uint16_t cpu;
+} mem_trace_rec_t;
 
 void mem_init(void);
 void* kmalloc(uint32_t size);
 void kfree(void* ptr);
+void mem_drain_cpu_cache(void);
 
+void mem_get_class_stats(int class_idx, mem_class_stats_t* out);
 void mem_info(void);
 
+void mem_trace_enable(bool enable);
+bool mem_trace_is_enabled(void);
+void mem_trace_clear(void);
+uint32_t mem_trace_snapshot(mem_trace_rec_t* out, uint32_t max);
+
 #endif
@@ -15,12 +15,45 @@ typedef struct {
 } efi_mem_desc_t;
 #pragma pack(pop)
 
+// 伙伴系统最大阶：单块最多 2^10 页 (4MB)，更大的请求由多个最大阶块拼接
+#define PMM_MAX_ORDER 10
+
+// NUMA 节点上限：节点号占 page_order 的 3 位
+#define PMM_MAX_NODES   8
+
+// 每 CPU 热页链表默认水位线 (页)
+#define PMM_PCP_LOW     0
+#define PMM_PCP_HIGH    96
+#define PMM_PCP_BATCH   16
+
+// 预清零页池：目标页数，以及伙伴系统低于该页数时停止补充
+#define PMM_ZERO_POOL_TARGET    64
+#define PMM_ZERO_POOL_RESERVE   1024
+#define PMM_ZERO_REFILL_BATCH   8
+
 // PMM 核心接口
 void pmm_init(void *mmap, size_t mmap_size, size_t desc_size);
 void *pmm_alloc_page();
 void *pmm_alloc_zpage();
 void *pmm_alloc_blocks(size_t count);
 void pmm_free_page(void *addr);
+void pmm_free_blocks(void *addr, size_t count);
+void pmm_drain_local();
+void pmm_set_pcp_watermarks(uint32_t low, uint32_t high, uint32_t batch);
+uint32_t pmm_zero_pool_refill(uint32_t max_pages);
+void pmm_zero_pool_drain();
+uint32_t pmm_zero_pool_count();
 uint64_t pmm_get_total_memory();
+uint64_t pmm_get_free_memory();
+uint64_t pmm_get_free_blocks(uint32_t order);
+
+// NUMA 接口
+void *pmm_alloc_blocks_node(uint32_t node, size_t count);
+uint32_t pmm_numa_node_count();
+uint32_t pmm_local_node();
+uint32_t pmm_addr_to_node(void *addr);
+uint32_t pmm_node_distance(uint32_t from, uint32_t to);
+uint64_t pmm_get_node_free_memory(uint32_t node);
+uint64_t pmm_get_node_total_memory(uint32_t node);
 
 #endif // PMM_H
\ No newline at end of file
@@ -2,15 +2,46 @@
 #define VMM_H
 
 #include "stdint.h"
+#include "stdbool.h"
 
 #define PAGE_SIZE 4096
+#define PAGE_SIZE_2M (1ULL << 21)
+#define PAGE_SIZE_1G (1ULL << 30)
 
 // 页表项标志位
 #define PTE_PRESENT  (1ULL << 0)
 #define PTE_WRITABLE (1ULL << 1)
 #define PTE_USER     (1ULL << 2)
+#define PTE_PWT      (1ULL << 3)
+#define PTE_PCD      (1ULL << 4)
+#define PTE_HUGE     (1ULL << 7)    // PDPT/PD 项中的 PS 位：1GB / 2MB 大页
+#define PTE_GLOBAL   (1ULL << 8)    // 全局页：切换 CR3 时不从 TLB 中刷出
 #define PTE_NX       (1ULL << 63)
 
+// PAT 第 1 项被改为写合并 (WC)，只需置 PWT 即可选中，4KB 页和大页写法相同
+#define PTE_WC       PTE_PWT
+
+// 内核链接在高半区 (见 kernel.ld)，物理内存全部直接映射到 PHYS_MAP_BASE 起
+#define KERNEL_VMA      0xFFFFFFFF80000000ULL
+#define PHYS_MAP_BASE   0xFFFF800000000000ULL
+
+// 按需分页的内核堆虚拟区间：只保留地址，首次访问时缺页分配物理页
+#define KERNEL_HEAP_BASE    0xFFFFC00000000000ULL
+#define KERNEL_HEAP_SIZE    (64ULL << 30)
+
+// 批量映射后逐页 invlpg 的上限，超过则重载 CR3 整体刷新
+#define VMM_FLUSH_THRESHOLD 32
+
+// 缺页错误码
+#define PF_PRESENT   (1ULL << 0)    // 0: 页不存在，1: 权限错误
+#define PF_WRITE     (1ULL << 1)
+
+#define VMM_MAX_DEMAND_REGIONS 4
+
+// PCID：CR3 低 12 位为地址空间标识，bit 63 置位表示切换时保留该标识的 TLB 项
+#define CR3_NOFLUSH     (1ULL << 63)
+#define VMM_MAX_ASID    4096        // PCID 0 留给内核地址空间
+
 // 地址掩码，用于提取物理地址
 #define PTE_ADDR_MASK 0x000FFFFFFFFFF000ULL
 
@@ -22,8 +53,50 @@
 
 typedef uint64_t pt_entry_t;
 
+// 地址空间：页表 + PCID。asid_gen 与全局代数不一致时需重新分配 PCID
+typedef struct {
+    pt_entry_t* pml4;
+    uint16_t asid;
+    uint64_t asid_gen;
+} vmm_space_t;
+
+// 判断按需区间内的地址当前是否已被保留，未保留的访问按普通缺页处理
+typedef bool (*vmm_demand_check_t)(uint64_t addr);
+
+pt_entry_t* vmm_get_kernel_pml4(void);
+uint64_t vmm_translate(pt_entry_t* pml4, uint64_t virt);
+
+// 内核映像内的地址按链接偏移换算，按需堆查页表 (先访问一次触发缺页映射)，
+// 直接映射区减去基址，其余为恒等映射
+static inline uint64_t virt_to_phys(const volatile void* addr) {
+    uint64_t v = (uint64_t)addr;
+    if (v >= KERNEL_VMA) return v - KERNEL_VMA;
+    if (v >= KERNEL_HEAP_BASE && v - KERNEL_HEAP_BASE < KERNEL_HEAP_SIZE) {
+        (void)*(const volatile uint8_t*)addr;
+        return vmm_translate(vmm_get_kernel_pml4(), v);
+    }
+    if (v >= PHYS_MAP_BASE) return v - PHYS_MAP_BASE;
+    return v;
+}
+
+static inline void* phys_to_virt(uint64_t phys) {
+    return (void*)(phys + PHYS_MAP_BASE);
+}
+
 void vmm_init();
 void vmm_map(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t flags);
+int vmm_map_range(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags);
+void vmm_unmap_range(pt_entry_t* pml4, uint64_t virt, uint64_t size);
+void vmm_map_large(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags);
 void vmm_switch_table(pt_entry_t* pml4);
+uint64_t vmm_dma_addr(const volatile void* addr, uint64_t size);
+int vmm_add_demand_region(uint64_t base, uint64_t size, vmm_demand_check_t check);
+uint64_t vmm_get_demand_faults(void);
+
+int vmm_space_init(vmm_space_t* space);
+void vmm_space_destroy(vmm_space_t* space);
+void vmm_switch_space(vmm_space_t* space);
+vmm_space_t* vmm_kernel_space(void);
+bool vmm_pcid_enabled(void);
 
 #endif // VMM_H
\ No newline at end of file
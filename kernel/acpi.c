@@ -0,0 +1,88 @@
+#include "acpi.h"
+#include "serial.h"
+#include "string.h"
+
+// ACPI 表位于 ACPIReclaim/NVS 内存中，PMM 不会回收，直接按物理地址 (恒等映射) 访问
+static acpi_sdt_header_t* root_table;
+static bool root_is_xsdt;
+
+static bool acpi_checksum_ok(const void* data, uint32_t length) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum += p[i];
+    }
+    return sum == 0;
+}
+
+void acpi_init(uint64_t rsdp_addr) {
+    root_table = NULL;
+    root_is_xsdt = false;
+
+    if (rsdp_addr == 0) {
+        serial_puts("ACPI: no RSDP from firmware\n");
+        return;
+    }
+
+    acpi_rsdp_t* rsdp = (acpi_rsdp_t*)rsdp_addr;
+    if (memcmp(rsdp->signature, "RSD PTR ", 8) != 0 || !acpi_checksum_ok(rsdp, 20)) {
+        serial_puts("ACPI: invalid RSDP\n");
+        return;
+    }
+
+    if (rsdp->revision >= 2 && rsdp->xsdt_addr != 0) {
+        root_table = (acpi_sdt_header_t*)rsdp->xsdt_addr;
+        root_is_xsdt = true;
+    } else {
+        root_table = (acpi_sdt_header_t*)(uint64_t)rsdp->rsdt_addr;
+    }
+
+    if (!acpi_checksum_ok(root_table, root_table->length)) {
+        serial_puts("ACPI: root table checksum error\n");
+        root_table = NULL;
+        return;
+    }
+
+    serial_puts("ACPI: ");
+    serial_puts(root_is_xsdt ? "XSDT" : "RSDT");
+    serial_puts(" at ");
+    serial_puthex64((uint64_t)root_table);
+    serial_puts("\n");
+}
+
+bool acpi_available(void) {
+    return root_table != NULL;
+}
+
+acpi_sdt_header_t* acpi_find_table(const char* signature) {
+    if (!root_table) {
+        return NULL;
+    }
+
+    uint32_t entry_size = root_is_xsdt ? 8 : 4;
+    uint32_t count = (root_table->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uint8_t* entries = (uint8_t*)root_table + sizeof(acpi_sdt_header_t);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t addr;
+        if (root_is_xsdt) {
+            memcpy(&addr, entries + i * 8, 8);
+        } else {
+            uint32_t addr32;
+            memcpy(&addr32, entries + i * 4, 4);
+            addr = addr32;
+        }
+
+        acpi_sdt_header_t* table = (acpi_sdt_header_t*)addr;
+        if (table && memcmp(table->signature, signature, 4) == 0) {
+            if (!acpi_checksum_ok(table, table->length)) {
+                serial_puts("ACPI: checksum error in ");
+                serial_puts(signature);
+                serial_puts("\n");
+                return NULL;
+            }
+            return table;
+        }
+    }
+    return NULL;
+}
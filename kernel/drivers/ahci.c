@@ -0,0 +1,364 @@
+#include "drivers/ahci.h"
+#include "drivers/pci.h"
+#include "serial.h"
+#include "string.h"
+#include "pmm.h"
+#include "vmm.h"
+
+// 命令头：每个命令槽一个，共 32 个组成命令列表
+typedef struct __attribute__((packed)) {
+    uint16_t flags;             // CFL[4:0]，W = bit 6
+    uint16_t prdtl;             // PRDT 项数
+    volatile uint32_t prdbc;    // 已传输字节数
+    uint32_t ctba;
+    uint32_t ctbau;
+    uint32_t reserved[4];
+} ahci_cmd_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t dba;
+    uint32_t dbau;
+    uint32_t reserved;
+    uint32_t dbc;               // 字节数 - 1，bit 31 为完成中断
+} ahci_prdt_entry_t;
+
+// 命令表：128 字节头部 + PRDT，需 128 字节对齐
+typedef struct __attribute__((packed)) {
+    uint8_t cfis[64];
+    uint8_t acmd[16];
+    uint8_t reserved[48];
+    ahci_prdt_entry_t prdt[AHCI_PRDT_ENTRIES];
+} ahci_cmd_table_t;
+
+#define AHCI_CMD_HEADER_WRITE   (1 << 6)
+#define AHCI_FIS_DWORDS         5
+#define AHCI_BOUNCE_PAGES       32      // 可容纳 255 扇区
+#define AHCI_SPIN_TIMEOUT       10000000
+
+static volatile uint8_t* abar = NULL;
+static uint32_t port_no = 0;
+static uint32_t hba_cap = 0;
+static ahci_cmd_header_t* cmd_list = NULL;
+static uint8_t* fis_area = NULL;
+static ahci_cmd_table_t* cmd_tables = NULL;
+static uint8_t* bounce = NULL;
+static uint32_t slot_count = 1;
+static bool ncq_enabled = false;
+static bool ahci_ready = false;
+
+static inline uint32_t hba_read(uint32_t reg) {
+    return *(volatile uint32_t*)(abar + reg);
+}
+
+static inline void hba_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(abar + reg) = value;
+}
+
+static inline uint32_t port_read(uint32_t reg) {
+    return hba_read(AHCI_PORT_BASE(port_no) + reg);
+}
+
+static inline void port_write(uint32_t reg, uint32_t value) {
+    hba_write(AHCI_PORT_BASE(port_no) + reg, value);
+}
+
+static void ahci_stop_port(void) {
+    port_write(AHCI_PxCMD, port_read(AHCI_PxCMD) & ~(AHCI_PxCMD_ST | AHCI_PxCMD_FRE));
+
+    uint32_t timeout = AHCI_SPIN_TIMEOUT;
+    while ((port_read(AHCI_PxCMD) & (AHCI_PxCMD_CR | AHCI_PxCMD_FR)) && --timeout);
+}
+
+static void ahci_start_port(void) {
+    uint32_t timeout = AHCI_SPIN_TIMEOUT;
+    while ((port_read(AHCI_PxCMD) & AHCI_PxCMD_CR) && --timeout);
+
+    port_write(AHCI_PxCMD, port_read(AHCI_PxCMD) | AHCI_PxCMD_FRE);
+    port_write(AHCI_PxCMD, port_read(AHCI_PxCMD) | AHCI_PxCMD_ST);
+}
+
+// 任务文件错误后重启命令引擎，丢弃所有未完成命令
+static void ahci_recover(void) {
+    ahci_stop_port();
+    port_write(AHCI_PxSERR, 0xFFFFFFFF);
+    port_write(AHCI_PxIS, 0xFFFFFFFF);
+    ahci_start_port();
+}
+
+static bool ahci_build_command(uint32_t slot, uint8_t command, uint64_t lba,
+                               uint16_t count, void* buffer, uint32_t bytes, bool write) {
+    ahci_cmd_header_t* hdr = &cmd_list[slot];
+    ahci_cmd_table_t* tbl = &cmd_tables[slot];
+
+    memset(tbl, 0, sizeof(ahci_cmd_table_t));
+
+    // 按 4MB 上限拆分为 PRDT 分散/聚集项
+    uint64_t addr = virt_to_phys(buffer);
+    uint16_t n = 0;
+    while (bytes > 0) {
+        if (n >= AHCI_PRDT_ENTRIES) return false;
+
+        uint32_t chunk = bytes > AHCI_PRD_MAX_BYTES ? AHCI_PRD_MAX_BYTES : bytes;
+        tbl->prdt[n].dba = (uint32_t)addr;
+        tbl->prdt[n].dbau = (uint32_t)(addr >> 32);
+        tbl->prdt[n].dbc = chunk - 1;
+
+        addr += chunk;
+        bytes -= chunk;
+        n++;
+    }
+
+    uint8_t* fis = tbl->cfis;
+    fis[0] = FIS_TYPE_REG_H2D;
+    fis[1] = 0x80;                  // C = 1：命令寄存器更新
+    fis[2] = command;
+    fis[4] = (uint8_t)(lba);
+    fis[5] = (uint8_t)(lba >> 8);
+    fis[6] = (uint8_t)(lba >> 16);
+    fis[7] = command == ATA_CMD_IDENTIFY ? 0 : 0x40;
+    fis[8] = (uint8_t)(lba >> 24);
+    fis[9] = (uint8_t)(lba >> 32);
+    fis[10] = (uint8_t)(lba >> 40);
+
+    if (command == ATA_CMD_READ_FPDMA || command == ATA_CMD_WRITE_FPDMA) {
+        // NCQ：扇区数放在 feature 字段，tag 放在 count[7:3]
+        fis[3] = (uint8_t)count;
+        fis[11] = (uint8_t)(count >> 8);
+        fis[12] = (uint8_t)(slot << 3);
+    } else {
+        fis[12] = (uint8_t)count;
+        fis[13] = (uint8_t)(count >> 8);
+    }
+
+    hdr->flags = AHCI_FIS_DWORDS | (write ? AHCI_CMD_HEADER_WRITE : 0);
+    hdr->prdtl = n;
+    hdr->prdbc = 0;
+    hdr->ctba = (uint32_t)(uint64_t)tbl;
+    hdr->ctbau = (uint32_t)((uint64_t)tbl >> 32);
+
+    return true;
+}
+
+static void ahci_issue(uint32_t slot, bool queued) {
+    if (queued) {
+        port_write(AHCI_PxSACT, 1U << slot);
+    }
+    port_write(AHCI_PxCI, 1U << slot);
+}
+
+// 轮询等待 mask 中的命令槽全部完成
+static int ahci_wait(uint32_t mask) {
+    uint32_t spins = AHCI_SPIN_TIMEOUT;
+
+    while (1) {
+        if (port_read(AHCI_PxIS) & AHCI_PxIS_TFES) {
+            serial_puts("AHCI: task file error, TFD=0x");
+            serial_puthex32(port_read(AHCI_PxTFD));
+            serial_puts("\n");
+            ahci_recover();
+            return -1;
+        }
+
+        if (!((port_read(AHCI_PxCI) | port_read(AHCI_PxSACT)) & mask)) {
+            return 0;
+        }
+
+        if (--spins == 0) {
+            serial_puts("AHCI: command timeout\n");
+            ahci_recover();
+            return -1;
+        }
+    }
+}
+
+static int ahci_wait_idle(void) {
+    uint32_t spins = AHCI_SPIN_TIMEOUT;
+    while (port_read(AHCI_PxTFD) & (AHCI_TFD_BSY | AHCI_TFD_DRQ)) {
+        if (--spins == 0) return -1;
+    }
+    return 0;
+}
+
+static int ahci_simple_command(uint8_t command, uint64_t lba, uint16_t count,
+                               void* buffer, uint32_t bytes, bool write) {
+    if (ahci_wait_idle() != 0) return -1;
+    if (!ahci_build_command(0, command, lba, count, buffer, bytes, write)) return -1;
+
+    ahci_issue(0, false);
+    return ahci_wait(1U << 0);
+}
+
+static bool ahci_buffer_usable(void* buffer, uint32_t bytes) {
+    uint64_t addr = vmm_dma_addr(buffer, bytes);
+    if (addr == 0) return false;
+    if (addr & 1) return false;
+    if (!(hba_cap & AHCI_CAP_S64A) && addr + bytes > 0x100000000ULL) return false;
+    return true;
+}
+
+static int ahci_transfer(uint64_t lba, uint32_t num_sectors, void* buffer, bool write) {
+    if (!ahci_ready || num_sectors == 0) return -1;
+
+    uint32_t total_bytes = num_sectors * 512;
+    uint8_t* buf = (uint8_t*)buffer;
+
+    if (!ahci_buffer_usable(buffer, total_bytes)) {
+        if (total_bytes > AHCI_BOUNCE_PAGES * 4096) return -1;
+        if (write) memcpy(bounce, buffer, total_bytes);
+        buf = bounce;
+    }
+
+    if (ahci_wait_idle() != 0) return -1;
+
+    // NCQ 下把请求拆成多个命令同时排队，由磁盘自行调度
+    uint32_t done = 0;
+    uint32_t slot = 0;
+    uint32_t pending = 0;
+
+    while (done < num_sectors) {
+        uint32_t n = num_sectors - done;
+        uint8_t command;
+
+        if (ncq_enabled) {
+            if (n > AHCI_CHUNK_SECTORS) n = AHCI_CHUNK_SECTORS;
+            command = write ? ATA_CMD_WRITE_FPDMA : ATA_CMD_READ_FPDMA;
+        } else {
+            if (n > AHCI_MAX_DMA_SECTORS) n = AHCI_MAX_DMA_SECTORS;
+            command = write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+        }
+
+        if (!ahci_build_command(slot, command, lba + done, (uint16_t)n,
+                                buf + done * 512, n * 512, write)) {
+            return -1;
+        }
+
+        ahci_issue(slot, ncq_enabled);
+        pending |= 1U << slot;
+        done += n;
+        slot++;
+
+        if (slot == slot_count || !ncq_enabled) {
+            if (ahci_wait(pending) != 0) return -1;
+            pending = 0;
+            slot = 0;
+        }
+    }
+
+    if (pending && ahci_wait(pending) != 0) return -1;
+
+    if (write) {
+        return ahci_simple_command(ATA_CMD_FLUSH_EXT, 0, 0, NULL, 0, false);
+    }
+
+    if (buf != buffer) memcpy(buffer, bounce, total_bytes);
+    return 0;
+}
+
+int ahci_read_sectors(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    return ahci_transfer(lba, num_sectors, buffer, false);
+}
+
+int ahci_write_sectors(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    return ahci_transfer(lba, num_sectors, buffer, true);
+}
+
+int ahci_present(void) {
+    return ahci_ready;
+}
+
+static bool ahci_find_port(void) {
+    uint32_t pi = hba_read(AHCI_PI);
+
+    for (uint32_t p = 0; p < 32; p++) {
+        if (!(pi & (1U << p))) continue;
+
+        uint32_t ssts = hba_read(AHCI_PORT_BASE(p) + AHCI_PxSSTS);
+        uint32_t det = ssts & 0x0F;
+        uint32_t ipm = (ssts >> 8) & 0x0F;
+        uint32_t sig = hba_read(AHCI_PORT_BASE(p) + AHCI_PxSIG);
+
+        // DET=3: 设备存在且通信已建立；IPM=1: 活动状态
+        if (det == 3 && ipm == 1 && sig == AHCI_SIG_ATA) {
+            port_no = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ahci_init(void) {
+    pci_device_t pdev;
+
+    // 大容量存储控制器 / SATA 控制器 / AHCI 1.0
+    if (!pci_find_class(0x01, 0x06, &pdev) || pdev.prog_if != 0x01) {
+        return -1;
+    }
+
+    serial_puts("Initializing AHCI controller...\n");
+
+    uint32_t bar5 = pci_read_bar(&pdev, 5) & ~0x0FU;
+    if (bar5 == 0) {
+        serial_puts("AHCI: invalid ABAR\n");
+        return -1;
+    }
+
+    abar = (volatile uint8_t*)(uint64_t)bar5;
+    pci_enable_bus_master(&pdev);
+
+    hba_write(AHCI_GHC, hba_read(AHCI_GHC) | AHCI_GHC_AE);
+    hba_cap = hba_read(AHCI_CAP);
+
+    if (!ahci_find_port()) {
+        serial_puts("AHCI: no SATA disk found\n");
+        return -1;
+    }
+
+    // 第 0 页：命令列表 (1KB) + FIS 接收区 (256B)；第 1-2 页：32 个命令表
+    uint8_t* mem = (uint8_t*)pmm_alloc_blocks(3);
+    bounce = (uint8_t*)pmm_alloc_blocks(AHCI_BOUNCE_PAGES);
+    if (mem == NULL || bounce == NULL) {
+        serial_puts("AHCI: out of memory\n");
+        return -1;
+    }
+    memset(mem, 0, 3 * 4096);
+
+    cmd_list = (ahci_cmd_header_t*)mem;
+    fis_area = mem + 1024;
+    cmd_tables = (ahci_cmd_table_t*)(mem + 4096);
+
+    ahci_stop_port();
+
+    port_write(AHCI_PxCLB, (uint32_t)(uint64_t)cmd_list);
+    port_write(AHCI_PxCLBU, (uint32_t)((uint64_t)cmd_list >> 32));
+    port_write(AHCI_PxFB, (uint32_t)(uint64_t)fis_area);
+    port_write(AHCI_PxFBU, (uint32_t)((uint64_t)fis_area >> 32));
+    port_write(AHCI_PxSERR, 0xFFFFFFFF);
+    port_write(AHCI_PxIS, 0xFFFFFFFF);
+    port_write(AHCI_PxIE, 0);   // 轮询完成状态
+
+    ahci_start_port();
+    ahci_ready = true;
+
+    uint16_t identify[256];
+    if (ahci_simple_command(ATA_CMD_IDENTIFY, 0, 0, identify, 512, false) != 0) {
+        serial_puts("AHCI: IDENTIFY failed\n");
+        ahci_ready = false;
+        return -1;
+    }
+
+    // 队列深度取 HBA 命令槽数与设备 NCQ 深度的较小值
+    uint32_t hba_slots = ((hba_cap >> 8) & 0x1F) + 1;
+    bool dev_ncq = (identify[76] & (1 << 8)) != 0;
+    uint32_t dev_depth = (identify[75] & 0x1F) + 1;
+
+    ncq_enabled = (hba_cap & AHCI_CAP_SNCQ) && dev_ncq;
+    slot_count = ncq_enabled ? (hba_slots < dev_depth ? hba_slots : dev_depth) : 1;
+
+    serial_puts("AHCI: SATA disk on port ");
+    serial_putdec64(port_no);
+    serial_puts(ncq_enabled ? ", NCQ depth " : ", no NCQ, slots ");
+    serial_putdec64(slot_count);
+    serial_puts("\n");
+
+    return 0;
+}
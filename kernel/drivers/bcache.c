@@ -0,0 +1,317 @@
+#include "drivers/bcache.h"
+#include "drivers/disk.h"
+#include "drivers/blkdev.h"
+#include "serial.h"
+#include "string.h"
+#include <stdbool.h>
+
+// 缓存项：按 LBA 哈希索引，同时挂在 LRU 双向链表上
+typedef struct bcache_entry {
+    uint32_t lba;
+    bool     valid;
+    bool     dirty;
+    bool     writeback;     // 批量回写中，bio 已提交
+    bio_t    bio;
+    struct bcache_entry* hash_next;
+    struct bcache_entry* lru_prev;
+    struct bcache_entry* lru_next;
+    uint8_t  data[BCACHE_SECTOR_SIZE] __attribute__((aligned(16)));
+} bcache_entry_t;
+
+static bcache_entry_t entries[BCACHE_ENTRIES];
+static bcache_entry_t* hash_table[BCACHE_HASH_BUCKETS];
+
+// LRU 链表：头部最近使用，尾部最久未使用
+static bcache_entry_t* lru_head = NULL;
+static bcache_entry_t* lru_tail = NULL;
+
+static bcache_stats_t stats;
+static bool bcache_ready = false;
+
+static inline uint32_t bcache_hash(uint32_t lba) {
+    return lba & (BCACHE_HASH_BUCKETS - 1);
+}
+
+static void lru_unlink(bcache_entry_t* e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+    else lru_head = e->lru_next;
+
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+    else lru_tail = e->lru_prev;
+
+    e->lru_prev = NULL;
+    e->lru_next = NULL;
+}
+
+static void lru_push_front(bcache_entry_t* e) {
+    e->lru_prev = NULL;
+    e->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = e;
+    lru_head = e;
+    if (!lru_tail) lru_tail = e;
+}
+
+// 失效的缓存项放到尾部，优先被复用
+static void lru_push_back(bcache_entry_t* e) {
+    e->lru_next = NULL;
+    e->lru_prev = lru_tail;
+    if (lru_tail) lru_tail->lru_next = e;
+    lru_tail = e;
+    if (!lru_head) lru_head = e;
+}
+
+static void lru_touch(bcache_entry_t* e) {
+    if (lru_head == e) return;
+    lru_unlink(e);
+    lru_push_front(e);
+}
+
+static void hash_insert(bcache_entry_t* e) {
+    uint32_t h = bcache_hash(e->lba);
+    e->hash_next = hash_table[h];
+    hash_table[h] = e;
+}
+
+static void hash_remove(bcache_entry_t* e) {
+    bcache_entry_t** pp = &hash_table[bcache_hash(e->lba)];
+    while (*pp) {
+        if (*pp == e) {
+            *pp = e->hash_next;
+            e->hash_next = NULL;
+            return;
+        }
+        pp = &(*pp)->hash_next;
+    }
+}
+
+static bcache_entry_t* bcache_lookup(uint32_t lba) {
+    bcache_entry_t* e = hash_table[bcache_hash(lba)];
+    while (e) {
+        if (e->valid && e->lba == lba) return e;
+        e = e->hash_next;
+    }
+    return NULL;
+}
+
+// 丢弃缓存项（不回写），放到 LRU 尾部优先复用
+static void bcache_drop_entry(bcache_entry_t* e) {
+    hash_remove(e);
+    e->valid = false;
+    if (e->dirty) {
+        e->dirty = false;
+        stats.dirty--;
+    }
+    stats.cached--;
+    lru_unlink(e);
+    lru_push_back(e);
+}
+
+static int bcache_flush_entry(bcache_entry_t* e) {
+    if (!e->valid || !e->dirty) return 0;
+
+    if (disk_write_sectors(e->lba, 1, e->data) != 0) {
+        serial_puts("bcache: write-back failed at LBA ");
+        serial_putdec64(e->lba);
+        serial_puts("\n");
+        return -1;
+    }
+
+    e->dirty = false;
+    stats.dirty--;
+    stats.writebacks++;
+    return 0;
+}
+
+// 从 LRU 尾部向头部找一个可复用的缓存项，脏数据先回写。
+// 回写失败的项保持脏状态移到头部 (sync 时仍会重试)，继续找下一个，
+// 只有所有项都无法回写时才失败，避免一个坏扇区拖垮整个缓存
+static bcache_entry_t* bcache_evict(void) {
+    bcache_entry_t* e = lru_tail;
+
+    for (int i = 0; i < BCACHE_ENTRIES && e; i++) {
+        bcache_entry_t* prev = e->lru_prev;
+
+        if (!e->valid) return e;
+
+        if (!e->writeback) {
+            if (bcache_flush_entry(e) == 0) {
+                hash_remove(e);
+                e->valid = false;
+                stats.cached--;
+                stats.evictions++;
+                return e;
+            }
+            lru_touch(e);
+        }
+        e = prev;
+    }
+
+    return NULL;
+}
+
+static bcache_entry_t* bcache_install(uint32_t lba) {
+    bcache_entry_t* e = bcache_evict();
+    if (!e) return NULL;
+
+    e->lba = lba;
+    e->valid = true;
+    e->dirty = false;
+    hash_insert(e);
+    lru_touch(e);
+    stats.cached++;
+    return e;
+}
+
+void bcache_init(void) {
+    memset(entries, 0, sizeof(entries));
+    memset(hash_table, 0, sizeof(hash_table));
+    memset(&stats, 0, sizeof(stats));
+
+    lru_head = NULL;
+    lru_tail = NULL;
+    for (int i = 0; i < BCACHE_ENTRIES; i++) {
+        lru_push_front(&entries[i]);
+    }
+
+    bcache_ready = true;
+
+    serial_puts("Block cache initialized (");
+    serial_putdec64(BCACHE_ENTRIES);
+    serial_puts(" sectors)\n");
+}
+
+int bcache_read(uint32_t lba, void* buffer) {
+    if (!bcache_ready) bcache_init();
+
+    bcache_entry_t* e = bcache_lookup(lba);
+    if (e) {
+        stats.hits++;
+        lru_touch(e);
+        memcpy(buffer, e->data, BCACHE_SECTOR_SIZE);
+        return 0;
+    }
+
+    stats.misses++;
+
+    e = bcache_install(lba);
+    if (!e) return -1;
+
+    if (disk_read_sectors(lba, 1, e->data) != 0) {
+        bcache_drop_entry(e);
+        return -1;
+    }
+
+    memcpy(buffer, e->data, BCACHE_SECTOR_SIZE);
+    return 0;
+}
+
+int bcache_write(uint32_t lba, const void* buffer) {
+    if (!bcache_ready) bcache_init();
+
+    bcache_entry_t* e = bcache_lookup(lba);
+    if (e) {
+        stats.hits++;
+        lru_touch(e);
+    } else {
+        // 整扇区覆盖写，无需先从磁盘读取
+        stats.misses++;
+        e = bcache_install(lba);
+        if (!e) return -1;
+    }
+
+    memcpy(e->data, buffer, BCACHE_SECTOR_SIZE);
+    if (!e->dirty) {
+        e->dirty = true;
+        stats.dirty++;
+    }
+    return 0;
+}
+
+// 批量回写 [lba, lba + count) 内的脏扇区：全部提交给块设备层后统一等待，
+// 由电梯排序合并成少量大请求
+static int bcache_writeback_range(uint32_t lba, uint32_t count) {
+    blkdev_t* dev = blkdev_get_default();
+    int result = 0;
+
+    if (!dev) {
+        for (int i = 0; i < BCACHE_ENTRIES; i++) {
+            bcache_entry_t* e = &entries[i];
+            if (e->valid && e->lba >= lba && e->lba - lba < count) {
+                if (bcache_flush_entry(e) != 0) result = -1;
+            }
+        }
+        return result;
+    }
+
+    bool pending = false;
+    for (int i = 0; i < BCACHE_ENTRIES; i++) {
+        bcache_entry_t* e = &entries[i];
+        if (e->valid && e->dirty && e->lba >= lba && e->lba - lba < count) {
+            bio_init(&e->bio, e->lba, 1, e->data, true);
+            e->writeback = true;
+            submit_bio(dev, &e->bio);
+            pending = true;
+        }
+    }
+
+    if (!pending) return 0;
+    blk_drain(dev);
+
+    for (int i = 0; i < BCACHE_ENTRIES; i++) {
+        bcache_entry_t* e = &entries[i];
+        if (!e->writeback) continue;
+
+        e->writeback = false;
+        if (!e->bio.done || e->bio.status != 0) {
+            serial_puts("bcache: write-back failed at LBA ");
+            serial_putdec64(e->lba);
+            serial_puts("\n");
+            result = -1;
+            continue;
+        }
+
+        e->dirty = false;
+        stats.dirty--;
+        stats.writebacks++;
+    }
+    return result;
+}
+
+int bcache_sync(void) {
+    if (!bcache_ready) return 0;
+    return bcache_writeback_range(0, 0xFFFFFFFF);
+}
+
+void bcache_invalidate(void) {
+    if (!bcache_ready) return;
+
+    for (int i = 0; i < BCACHE_ENTRIES; i++) {
+        if (entries[i].valid) {
+            bcache_drop_entry(&entries[i]);
+        }
+    }
+}
+
+// 绕过缓存直接读磁盘前调用：回写范围内的脏扇区
+int bcache_flush_range(uint32_t lba, uint32_t count) {
+    if (!bcache_ready) return 0;
+    return bcache_writeback_range(lba, count);
+}
+
+// 绕过缓存直接写磁盘前调用：丢弃范围内即将过期的缓存扇区
+void bcache_invalidate_range(uint32_t lba, uint32_t count) {
+    if (!bcache_ready) return;
+
+    for (int i = 0; i < BCACHE_ENTRIES; i++) {
+        bcache_entry_t* e = &entries[i];
+        if (e->valid && e->lba >= lba && e->lba - lba < count) {
+            bcache_drop_entry(e);
+        }
+    }
+}
+
+void bcache_get_stats(bcache_stats_t* out) {
+    if (out) {
+        *out = stats;
+    }
+}
@@ -0,0 +1,462 @@
+#include "drivers/blkdev.h"
+#include "serial.h"
+#include "string.h"
+#include "timer.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "cpu.h"
+
+// 合并后下发给驱动的请求，bios 为按 LBA 连续的 bio 链
+typedef struct {
+    bool in_use;
+    blkdev_t* dev;
+    bio_t* bios;
+    uint64_t lba;
+    uint32_t count;
+    bool write;
+    void* buffer;
+    int bounce;             // 使用的中转缓冲编号，-1 表示零拷贝
+} blk_request_t;
+
+#define BLK_BOUNCE_PAGES    ((BLK_MAX_SECTORS * BLK_SECTOR_SIZE + 4095) / 4096)
+
+static blkdev_t devices[BLKDEV_MAX_DEVICES];
+static int device_count = 0;
+static blkdev_t* default_dev = NULL;
+static blk_request_t requests[BLK_MAX_REQUESTS];
+
+// 中转缓冲在初始化时预分配，完成回调可能在中断中释放，不能走 PMM
+static void* bounce_buffers[BLK_BOUNCE_BUFFERS];
+static volatile bool bounce_in_use[BLK_BOUNCE_BUFFERS];
+
+void blkdev_init(void) {
+    memset(devices, 0, sizeof(devices));
+    memset(requests, 0, sizeof(requests));
+    device_count = 0;
+    default_dev = NULL;
+
+    for (int i = 0; i < BLK_BOUNCE_BUFFERS; i++) {
+        bounce_buffers[i] = pmm_alloc_blocks(BLK_BOUNCE_PAGES);
+        bounce_in_use[i] = false;
+    }
+}
+
+static int blk_alloc_bounce(void) {
+    uint64_t flags = cpu_irq_save();
+    for (int i = 0; i < BLK_BOUNCE_BUFFERS; i++) {
+        if (bounce_buffers[i] && !bounce_in_use[i]) {
+            bounce_in_use[i] = true;
+            cpu_irq_restore(flags);
+            return i;
+        }
+    }
+    cpu_irq_restore(flags);
+    return -1;
+}
+
+blkdev_t* blkdev_register(const char* name, const blkdev_ops_t* ops) {
+    if (device_count >= BLKDEV_MAX_DEVICES || !ops || !ops->read || !ops->write) {
+        return NULL;
+    }
+
+    blkdev_t* dev = &devices[device_count++];
+    memset(dev, 0, sizeof(*dev));
+    strncpy(dev->name, name, sizeof(dev->name) - 1);
+    dev->ops = *ops;
+
+    if (!default_dev) default_dev = dev;
+
+    serial_puts("blkdev: registered ");
+    serial_puts(dev->name);
+    serial_puts(ops->queue ? " (async)\n" : "\n");
+    return dev;
+}
+
+blkdev_t* blkdev_get(const char* name) {
+    for (int i = 0; i < device_count; i++) {
+        if (strcmp(devices[i].name, name) == 0) return &devices[i];
+    }
+    return NULL;
+}
+
+blkdev_t* blkdev_get_default(void) {
+    return default_dev;
+}
+
+void blkdev_set_default(blkdev_t* dev) {
+    if (dev) default_dev = dev;
+}
+
+int blkdev_count(void) {
+    return device_count;
+}
+
+blkdev_t* blkdev_get_index(int index) {
+    if (index < 0 || index >= device_count) return NULL;
+    return &devices[index];
+}
+
+void bio_init(bio_t* bio, uint64_t lba, uint32_t count, void* buffer, bool write) {
+    memset(bio, 0, sizeof(*bio));
+    bio->lba = lba;
+    bio->count = count;
+    bio->buffer = buffer;
+    bio->write = write;
+}
+
+static void bio_complete(bio_t* bio, int status) {
+    bio->status = status;
+    bio->done = true;
+    if (bio->end_io) bio->end_io(bio);
+}
+
+// 驱动完成回调，可能在中断上下文中执行
+static void blk_request_done(void* ctx, int status) {
+    blk_request_t* req = (blk_request_t*)ctx;
+    blkdev_t* dev = req->dev;
+    bio_t* bio = req->bios;
+
+    if (req->bounce >= 0) {
+        if (!req->write && status == 0) {
+            uint8_t* src = (uint8_t*)req->buffer;
+            for (bio_t* b = bio; b; b = b->next) {
+                memcpy(b->buffer, src, b->count * BLK_SECTOR_SIZE);
+                src += b->count * BLK_SECTOR_SIZE;
+            }
+        }
+    }
+
+    uint64_t flags = cpu_irq_save();
+    if (req->bounce >= 0) bounce_in_use[req->bounce] = false;
+    if (status != 0) dev->stats.errors++;
+    req->bios = NULL;
+    req->in_use = false;
+    dev->inflight--;
+    cpu_irq_restore(flags);
+
+    while (bio) {
+        bio_t* next = bio->next;
+        bio->next = NULL;
+        bio_complete(bio, status);
+        bio = next;
+    }
+}
+
+static blk_request_t* blk_alloc_request(blkdev_t* dev) {
+    for (uint32_t spins = 0; spins < 1000000; spins++) {
+        uint64_t flags = cpu_irq_save();
+        for (int i = 0; i < BLK_MAX_REQUESTS; i++) {
+            if (!requests[i].in_use) {
+                requests[i].in_use = true;
+                dev->inflight++;
+                cpu_irq_restore(flags);
+                return &requests[i];
+            }
+        }
+        cpu_irq_restore(flags);
+
+        // 请求池耗尽：通知设备处理已入队的请求并回收完成项
+        if (dev->ops.kick) dev->ops.kick();
+        if (dev->ops.poll) dev->ops.poll();
+        asm volatile("pause");
+    }
+    return NULL;
+}
+
+static int blk_sync_io(blkdev_t* dev, uint64_t lba, uint32_t count, void* buffer, bool write) {
+    uint8_t* buf = (uint8_t*)buffer;
+    blk_io_func io = write ? dev->ops.write : dev->ops.read;
+
+    while (count > 0) {
+        uint32_t n = count > BLK_MAX_SECTORS ? BLK_MAX_SECTORS : count;
+        if (io(lba, n, buf) != 0) return -1;
+        lba += n;
+        buf += n * BLK_SECTOR_SIZE;
+        count -= n;
+    }
+    return 0;
+}
+
+static void blk_dispatch(blkdev_t* dev, bio_t* bios, uint32_t count, bool contiguous) {
+    bool write = bios->write;
+    void* buffer = bios->buffer;
+    int bounce = -1;
+
+    // 物理上不连续的缓冲区 (按需堆中的 kmalloc 内存) 不能直接交给 DMA
+    if (contiguous && vmm_dma_addr(buffer, (uint64_t)count * BLK_SECTOR_SIZE) == 0) {
+        contiguous = false;
+    }
+
+    // 缓冲区不相邻的合并请求经由中转缓冲收发
+    if (!contiguous) {
+        bounce = blk_alloc_bounce();
+        // 单个 bio 无法再拆分，等待在途请求归还中转缓冲
+        for (uint32_t spins = 0; bounce < 0 && !bios->next && spins < 1000000; spins++) {
+            if (dev->ops.kick) dev->ops.kick();
+            if (dev->ops.poll) dev->ops.poll();
+            asm volatile("pause");
+            bounce = blk_alloc_bounce();
+        }
+        if (bounce < 0 && !bios->next) {
+            serial_puts("blkdev: no bounce buffer available\n");
+            bio_complete(bios, -1);
+            return;
+        }
+        if (bounce < 0) {
+            // 中转缓冲用尽则退化为逐个派发
+            while (bios) {
+                bio_t* next = bios->next;
+                bios->next = NULL;
+                blk_dispatch(dev, bios, bios->count, true);
+                bios = next;
+            }
+            return;
+        }
+
+        buffer = bounce_buffers[bounce];
+        if (write) {
+            uint8_t* dst = (uint8_t*)buffer;
+            for (bio_t* b = bios; b; b = b->next) {
+                memcpy(dst, b->buffer, b->count * BLK_SECTOR_SIZE);
+                dst += b->count * BLK_SECTOR_SIZE;
+            }
+        }
+        dev->stats.bounced++;
+    }
+
+    blk_request_t* req = blk_alloc_request(dev);
+    if (!req) {
+        serial_puts("blkdev: request pool exhausted\n");
+        if (bounce >= 0) bounce_in_use[bounce] = false;
+        while (bios) {
+            bio_t* next = bios->next;
+            bios->next = NULL;
+            bio_complete(bios, -1);
+            bios = next;
+        }
+        return;
+    }
+
+    req->dev = dev;
+    req->bios = bios;
+    req->lba = bios->lba;
+    req->count = count;
+    req->write = write;
+    req->buffer = buffer;
+    req->bounce = bounce;
+    dev->stats.dispatched++;
+
+    if (dev->ops.queue) {
+        for (uint32_t tries = 0; tries < 1000000; tries++) {
+            if (dev->ops.queue(req->lba, count, buffer, write, blk_request_done, req) == 0) {
+                return;
+            }
+            // 设备队列已满：先让设备处理已入队的请求
+            if (dev->ops.kick) dev->ops.kick();
+            if (dev->ops.poll) dev->ops.poll();
+            asm volatile("pause");
+        }
+        blk_request_done(req, -1);
+        return;
+    }
+
+    blk_request_done(req, blk_sync_io(dev, req->lba, count, buffer, write));
+}
+
+static inline bool blk_range_overlap(uint64_t a, uint32_t an, uint64_t b, uint32_t bn) {
+    return a < b + bn && b < a + an;
+}
+
+// 与队列中或在途的请求重叠时需要保序
+static bool blk_overlaps(blkdev_t* dev, const bio_t* bio) {
+    for (bio_t* p = dev->queue; p; p = p->next) {
+        if (blk_range_overlap(p->lba, p->count, bio->lba, bio->count)) return true;
+    }
+
+    if (dev->inflight == 0) return false;
+
+    for (int i = 0; i < BLK_MAX_REQUESTS; i++) {
+        blk_request_t* req = &requests[i];
+        if (req->in_use && req->dev == dev &&
+            blk_range_overlap(req->lba, req->count, bio->lba, bio->count)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void submit_bio(blkdev_t* dev, bio_t* bio) {
+    if (!bio) return;
+
+    bio->done = false;
+    bio->status = 0;
+    bio->next = NULL;
+
+    // 超过单个请求上限的 bio 无法检查物理连续性和中转，须由调用者拆分 (见 blk_rw)
+    if (!dev || bio->count == 0 || bio->count > BLK_MAX_SECTORS) {
+        bio_complete(bio, -1);
+        return;
+    }
+
+    dev->stats.submitted++;
+
+    if (blk_overlaps(dev, bio)) {
+        blk_drain(dev);
+    }
+
+    // 电梯：按 LBA 升序插入，相同 LBA 保持提交顺序
+    bio_t** pp = &dev->queue;
+    while (*pp && (*pp)->lba <= bio->lba) {
+        pp = &(*pp)->next;
+    }
+    bio->next = *pp;
+    *pp = bio;
+    dev->queued++;
+
+    if (dev->queued >= BLK_QUEUE_MAX) {
+        blk_unplug(dev);
+    }
+}
+
+static inline bool blk_can_merge(const bio_t* prev, const bio_t* next, uint32_t count) {
+    return next->write == prev->write &&
+           next->lba == prev->lba + prev->count &&
+           count + next->count <= BLK_MAX_SECTORS;
+}
+
+// 派发队列：相邻 LBA 的同向 bio 合并为一个请求
+void blk_unplug(blkdev_t* dev) {
+    if (!dev) return;
+
+    while (dev->queue) {
+        bio_t* first = dev->queue;
+        bio_t* last = first;
+        uint32_t count = first->count;
+        uint32_t nbios = 1;
+        bool contiguous = true;
+
+        while (last->next && blk_can_merge(last, last->next, count)) {
+            bio_t* next = last->next;
+            if ((uint8_t*)last->buffer + last->count * BLK_SECTOR_SIZE != (uint8_t*)next->buffer) {
+                contiguous = false;
+            }
+            count += next->count;
+            nbios++;
+            last = next;
+        }
+
+        dev->queue = last->next;
+        last->next = NULL;
+        dev->queued -= nbios;
+        dev->stats.merged += nbios - 1;
+
+        blk_dispatch(dev, first, count, contiguous);
+    }
+
+    if (dev->ops.kick) dev->ops.kick();
+}
+
+static bool blk_wait_cond(blkdev_t* dev, volatile bool* done, volatile uint32_t* inflight) {
+    uint64_t rflags;
+    asm volatile("pushfq; pop %0" : "=r"(rflags));
+    bool can_halt = (rflags & 0x200) != 0;
+
+    uint64_t deadline = timer_get_ticks() + 5000;
+    uint32_t spins = 10000000;
+
+    for (;;) {
+        if (done && *done) return true;
+        if (inflight && *inflight == 0) return true;
+
+        if (dev->ops.poll) {
+            dev->ops.poll();
+            if (done && *done) return true;
+            if (inflight && *inflight == 0) return true;
+        }
+
+        if (can_halt) {
+            if (timer_get_ticks() > deadline) return false;
+            // 关中断后再查一次，完成中断落在检查与 hlt 之间时不会错过唤醒
+            asm volatile("cli" : : : "memory");
+            if ((done && *done) || (inflight && *inflight == 0)) {
+                asm volatile("sti" : : : "memory");
+                return true;
+            }
+            asm volatile("sti; hlt" : : : "memory");
+        } else if (--spins == 0) {
+            return false;
+        }
+    }
+}
+
+int blk_wait(blkdev_t* dev, bio_t* bio) {
+    if (!dev || !bio) return -1;
+
+    if (!bio->done) blk_unplug(dev);
+    if (!blk_wait_cond(dev, &bio->done, NULL)) {
+        serial_puts("blkdev: request timed out on ");
+        serial_puts(dev->name);
+        serial_puts("\n");
+        // bio 可能在调用者栈上，返回前必须保证设备不再完成它
+        blk_abort(dev);
+        return -1;
+    }
+    return bio->status;
+}
+
+// 放弃设备上所有未完成的 bio：队列中的直接以失败结束，
+// 在途的由驱动复位后回调失败。返回后不会再有 DMA 或完成回调
+void blk_abort(blkdev_t* dev) {
+    if (!dev) return;
+
+    uint64_t flags = cpu_irq_save();
+    bio_t* bio = dev->queue;
+    dev->queue = NULL;
+    dev->queued = 0;
+    cpu_irq_restore(flags);
+
+    while (bio) {
+        bio_t* next = bio->next;
+        bio->next = NULL;
+        bio_complete(bio, -1);
+        bio = next;
+    }
+
+    if (dev->inflight > 0) {
+        if (dev->ops.reset) {
+            dev->ops.reset();
+        } else {
+            serial_puts("blkdev: cannot abort in-flight requests on ");
+            serial_puts(dev->name);
+            serial_puts("\n");
+        }
+    }
+}
+
+void blk_drain(blkdev_t* dev) {
+    if (!dev) return;
+
+    blk_unplug(dev);
+    if (!blk_wait_cond(dev, NULL, &dev->inflight)) {
+        serial_puts("blkdev: drain timed out on ");
+        serial_puts(dev->name);
+        serial_puts("\n");
+    }
+}
+
+// 按 BLK_MAX_SECTORS 拆分，保证每个派发的请求都能做 DMA 检查或中转
+int blk_rw(blkdev_t* dev, uint64_t lba, uint32_t count, void* buffer, bool write) {
+    uint8_t* buf = (uint8_t*)buffer;
+
+    do {
+        uint32_t n = count > BLK_MAX_SECTORS ? BLK_MAX_SECTORS : count;
+        bio_t bio;
+        bio_init(&bio, lba, n, buf, write);
+        submit_bio(dev, &bio);
+        if (blk_wait(dev, &bio) != 0) return -1;
+        lba += n;
+        buf += n * BLK_SECTOR_SIZE;
+        count -= n;
+    } while (count > 0);
+    return 0;
+}
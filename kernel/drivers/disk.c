@@ -0,0 +1,60 @@
+#include "drivers/disk.h"
+#include "drivers/blkdev.h"
+#include "drivers/ide.h"
+#include "drivers/ahci.h"
+#include "drivers/virtio_blk.h"
+#include "serial.h"
+
+// 探测所有磁盘控制器并注册为块设备，优先级 virtio-blk > AHCI > IDE
+void disk_init(void) {
+    blkdev_init();
+
+    blkdev_t* preferred = NULL;
+
+    if (virtio_blk_init() == 0) {
+        blkdev_ops_t ops = {
+            .read = virtio_blk_read_sectors,
+            .write = virtio_blk_write_sectors,
+            .queue = virtio_blk_queue,
+            .kick = virtio_blk_kick,
+            .poll = virtio_blk_poll,
+            .reset = virtio_blk_reset,
+        };
+        preferred = blkdev_register("virtio0", &ops);
+    }
+
+    if (ahci_init() == 0) {
+        blkdev_ops_t ops = {
+            .read = ahci_read_sectors,
+            .write = ahci_write_sectors,
+        };
+        blkdev_t* dev = blkdev_register("ahci0", &ops);
+        if (!preferred) preferred = dev;
+    }
+
+    blkdev_ops_t ide_ops = {
+        .read = ide_read_sectors_ext,
+        .write = ide_write_sectors_ext,
+    };
+    blkdev_t* ide = blkdev_register("ide0", &ide_ops);
+    if (!preferred) preferred = ide;
+
+    blkdev_set_default(preferred);
+
+    serial_puts("Disk: using ");
+    serial_puts(disk_get_driver_name());
+    serial_puts(" as boot device\n");
+}
+
+int disk_read_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
+    return blk_rw(blkdev_get_default(), lba, num_sectors, buffer, false);
+}
+
+int disk_write_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
+    return blk_rw(blkdev_get_default(), lba, num_sectors, buffer, true);
+}
+
+const char* disk_get_driver_name(void) {
+    blkdev_t* dev = blkdev_get_default();
+    return dev ? dev->name : "none";
+}
@@ -1,8 +1,12 @@
 #include "drivers/fs/fat32.h"
-#include "drivers/ide.h"
+#include "drivers/disk.h"
+#include "drivers/bcache.h"
+#include "drivers/blkdev.h"
+#include "drivers/fs/pcache.h"
 #include "serial.h"
 #include "string.h"
 #include "memory.h"
+#include "pmm.h"
 #include <stdbool.h>
 
 static fat32_info_t fs_info;
@@ -13,6 +17,21 @@ static uint32_t partition_start = 0;
 static char error_msg[64] = {0};
 static char volume_label[12] = {0};
 
+// 文件页缓存预读：窗口以页为单位，顺序访问时逐次加倍，随机访问退回单页
+#define FAT32_RA_INIT       4
+#define FAT32_RA_MAX        32          // 128KB
+#define FAT32_RA_MAX_BIOS   64
+#define FAT32_PAGE_SECTORS  (PCACHE_PAGE_SIZE / 512)
+
+static bio_t ra_bios[FAT32_RA_MAX_BIOS];
+static pcache_page_t* ra_pages[FAT32_RA_MAX];
+static uint32_t ra_valid[FAT32_RA_MAX];
+static bool ra_pinned[FAT32_RA_MAX];
+static uint32_t ra_bio_count = 0;
+static uint32_t ra_page_count = 0;
+// 设备超时且无法复位时 ra_bios 可能仍被设备持有，之后改用同步读
+static bool ra_stuck = false;
+
 static void clear_error(void);
 static void set_error(const char* msg);
 static uint32_t read_sector(uint32_t sector, void* buffer);
@@ -22,6 +41,7 @@ static uint32_t sector_to_cluster(uint32_t sector);
 static uint32_t read_fat_entry(uint32_t cluster);
 static bool write_fat_entry(uint32_t cluster, uint32_t value);
 static uint32_t find_free_cluster(void);
+static uint32_t find_free_run(uint32_t want, uint32_t* run_len);
 static bool allocate_cluster_chain(uint32_t* cluster, uint32_t count);
 static bool free_cluster_chain(uint32_t cluster);
 static bool find_directory_entry(const char* path,
@@ -44,6 +64,7 @@ static uint32_t get_cluster_count(uint32_t first_cluster);
 static void update_fs_info_sector(void);
 static bool read_fs_info_sector(void);
 static uint32_t find_next_cluster(uint32_t current_cluster, uint32_t position, uint32_t bytes_per_cluster);
+static uint32_t resolve_file_cluster(fat32_handle_t* handle, uint32_t index);
 
 
 static void clear_error(void) {
@@ -65,11 +86,7 @@ static void set_error(const char* msg) {
 static uint32_t read_sector(uint32_t sector, void* buffer) {
     uint32_t physical_sector = partition_start + sector;
 
-    serial_puts("Reading physical LBA: ");
-    serial_putdec64(physical_sector);
-    serial_puts("\n");
-
-    return ide_read_sectors(physical_sector, 1, buffer);
+    return bcache_read(physical_sector, buffer);
 }
 
 static uint32_t write_sector(uint32_t sector, const void* buffer) {
@@ -80,11 +97,7 @@ static uint32_t write_sector(uint32_t sector, const void* buffer) {
 
     uint32_t physical_sector = partition_start + sector;
 
-    serial_puts("Writing physical LBA: ");
-    serial_putdec64(physical_sector);
-    serial_puts("\n");
-
-    return ide_write_sectors(physical_sector, 1, (void*)buffer);
+    return bcache_write(physical_sector, buffer);
 }
 
 
@@ -108,64 +121,346 @@ static uint32_t sector_to_cluster(uint32_t sector) {
     return 2 + (sector - fs_info.data_start_sector) / fs_info.sectors_per_cluster;
 }
 
-static uint8_t g_fat_read_buf[512] __attribute__((aligned(16)));
+// FAT 表缓存：FAT 常驻在 PMM 页中，按扇区记录脏位，sync 时批量回写所有 FAT 副本。
+// FAT 超过 FAT_CACHE_MAX_SECTORS 时只缓存一个窗口，访问窗口外的表项时滑动窗口。
+#define FAT_CACHE_MAX_SECTORS 2048
+#define FAT_IO_MAX_SECTORS    128
+
+static uint8_t* fat_cache = NULL;
+static uint32_t fat_cache_pages = 0;
+static uint32_t fat_cache_base = 0;       // 窗口起始扇区 (相对 FAT 起点)
+static uint32_t fat_cache_sectors = 0;    // 窗口扇区数
+static bool fat_cache_valid = false;
+static uint64_t fat_cache_dirty[FAT_CACHE_MAX_SECTORS / 64];
+
+// 空闲簇位图：挂载时由 FAT 构建，置位表示已占用。分配采用 next-fit，
+// 从 next_free_hint 开始搜索，提示值通过 FSInfo 扇区持久化。
+static uint64_t* free_map = NULL;
+static uint32_t free_map_pages = 0;
+static uint32_t free_map_limit = 0;       // 簇号上限 (不含)
+static uint32_t next_free_hint = 2;
+
+static inline void free_map_set(uint32_t cluster) {
+    if (free_map != NULL && cluster < free_map_limit) {
+        free_map[cluster / 64] |= 1ULL << (cluster % 64);
+    }
+}
 
-static uint32_t read_fat_entry(uint32_t cluster) {
-    if (cluster < 2 || cluster >= 127006) return 0x0FFFFFF7;
+static inline void free_map_clear(uint32_t cluster) {
+    if (free_map != NULL && cluster < free_map_limit) {
+        free_map[cluster / 64] &= ~(1ULL << (cluster % 64));
+    }
+}
+
+static inline bool free_map_test(uint32_t cluster) {
+    return (free_map[cluster / 64] >> (cluster % 64)) & 1;
+}
+
+static uint32_t read_sectors_raw(uint32_t sector, uint32_t count, void* buffer) {
+    uint8_t* buf = (uint8_t*)buffer;
+    while (count > 0) {
+        uint32_t n = count > FAT_IO_MAX_SECTORS ? FAT_IO_MAX_SECTORS : count;
+        if (disk_read_sectors(partition_start + sector, (uint8_t)n, buf) != 0) {
+            return 1;
+        }
+        sector += n;
+        count -= n;
+        buf += n * 512;
+    }
+    return 0;
+}
+
+static uint32_t write_sectors_raw(uint32_t sector, uint32_t count, const void* buffer) {
+    const uint8_t* buf = (const uint8_t*)buffer;
+    while (count > 0) {
+        uint32_t n = count > FAT_IO_MAX_SECTORS ? FAT_IO_MAX_SECTORS : count;
+        if (disk_write_sectors(partition_start + sector, (uint8_t)n, (void*)buf) != 0) {
+            return 1;
+        }
+        sector += n;
+        count -= n;
+        buf += n * 512;
+    }
+    return 0;
+}
+
+// 数据区多扇区直接传输，绕过块缓存前先保证缓存一致
+static uint32_t read_data_sectors(uint32_t sector, uint32_t count, void* buffer) {
+    if (bcache_flush_range(partition_start + sector, count) != 0) {
+        return 1;
+    }
+    return read_sectors_raw(sector, count, buffer);
+}
+
+static uint32_t write_data_sectors(uint32_t sector, uint32_t count, const void* buffer) {
+    if (fs_readonly) {
+        set_error("File system is read-only");
+        return 1;
+    }
+    bcache_invalidate_range(partition_start + sector, count);
+    return write_sectors_raw(sector, count, buffer);
+}
+
+static bool fat_cache_flush(void) {
+    if (!fat_cache_valid || fs_readonly) {
+        return true;
+    }
+
+    uint32_t fat_copies = bpb.fat_count ? bpb.fat_count : 1;
+    uint32_t s = 0;
 
+    while (s < fat_cache_sectors) {
+        if (!(fat_cache_dirty[s / 64] & (1ULL << (s % 64)))) {
+            s++;
+            continue;
+        }
+
+        // 合并连续的脏扇区为一次多扇区写
+        uint32_t run_start = s;
+        while (s < fat_cache_sectors && (fat_cache_dirty[s / 64] & (1ULL << (s % 64)))) {
+            s++;
+        }
+        uint32_t run_len = s - run_start;
+
+        for (uint32_t copy = 0; copy < fat_copies; copy++) {
+            uint32_t sector = fs_info.fat_start_sector + copy * fs_info.fat_sectors +
+                              fat_cache_base + run_start;
+            if (write_sectors_raw(sector, run_len, fat_cache + run_start * 512) != 0) {
+                set_error("Failed to write FAT");
+                return false;
+            }
+        }
+
+        for (uint32_t i = run_start; i < s; i++) {
+            fat_cache_dirty[i / 64] &= ~(1ULL << (i % 64));
+        }
+    }
+
+    return true;
+}
+
+static bool fat_cache_load(uint32_t fat_sector) {
+    if (!fat_cache_flush()) {
+        return false;
+    }
+
+    uint32_t window = fs_info.fat_sectors < FAT_CACHE_MAX_SECTORS ?
+                      fs_info.fat_sectors : FAT_CACHE_MAX_SECTORS;
+    uint32_t base = (fat_sector / window) * window;
+    uint32_t count = fs_info.fat_sectors - base;
+    if (count > window) count = window;
+
+    fat_cache_valid = false;
+    if (read_sectors_raw(fs_info.fat_start_sector + base, count, fat_cache) != 0) {
+        set_error("Failed to read FAT");
+        return false;
+    }
+
+    fat_cache_base = base;
+    fat_cache_sectors = count;
+    fat_cache_valid = true;
+    memset(fat_cache_dirty, 0, sizeof(fat_cache_dirty));
+    return true;
+}
+
+static bool fat_cache_init(void) {
+    uint32_t window = fs_info.fat_sectors < FAT_CACHE_MAX_SECTORS ?
+                      fs_info.fat_sectors : FAT_CACHE_MAX_SECTORS;
+
+    fat_cache_pages = (window * 512 + 4095) / 4096;
+    fat_cache = (uint8_t*)pmm_alloc_blocks(fat_cache_pages);
+    fat_cache_valid = false;
+    if (fat_cache == NULL) {
+        fat_cache_pages = 0;
+        set_error("Failed to allocate FAT cache");
+        return false;
+    }
+
+    return fat_cache_load(0);
+}
+
+static void fat_cache_release(void) {
+    if (fat_cache != NULL) {
+        pmm_free_blocks(fat_cache, fat_cache_pages);
+    }
+    fat_cache = NULL;
+    fat_cache_pages = 0;
+    fat_cache_sectors = 0;
+    fat_cache_valid = false;
+}
+
+// 返回缓存中表项的地址，必要时滑动窗口
+static uint32_t* fat_cache_entry(uint32_t cluster) {
     uint32_t fat_offset = cluster * 4;
-    uint32_t rel_sector = fs_info.fat_start_sector + (fat_offset / 512);
+    uint32_t fat_sector = fat_offset / 512;
 
-    static uint8_t f_buf[512] __attribute__((aligned(16)));
-    if (read_sector(rel_sector, f_buf) != 0) return 0x0FFFFFF7;
+    if (!fat_cache_valid ||
+        fat_sector < fat_cache_base ||
+        fat_sector >= fat_cache_base + fat_cache_sectors) {
+        if (fat_cache == NULL || !fat_cache_load(fat_sector)) {
+            return NULL;
+        }
+    }
 
-    uint32_t val = *(uint32_t*)(f_buf + (fat_offset % 512));
-    return val & 0x0FFFFFFF;
+    return (uint32_t*)(fat_cache + (fat_offset - fat_cache_base * 512));
 }
 
+static uint32_t read_fat_entry(uint32_t cluster) {
+    if (cluster < 2 || cluster >= 127006) return 0x0FFFFFF7;
 
+    uint32_t* entry = fat_cache_entry(cluster);
+    if (entry == NULL) return 0x0FFFFFF7;
+
+    return *entry & 0x0FFFFFFF;
+}
 
 static bool write_fat_entry(uint32_t cluster, uint32_t value) {
     if (cluster < 2 || cluster >= 127006) return false;
 
-    uint32_t fat_offset = cluster * 4;
-    uint32_t rel_sector = fs_info.fat_start_sector + (fat_offset / 512);
+    uint32_t* entry = fat_cache_entry(cluster);
+    if (entry == NULL) return false;
 
-    static uint8_t f_buf[512] __attribute__((aligned(16)));
-    if (read_sector(rel_sector, f_buf) != 0) return false;
+    bool was_free = (*entry & 0x0FFFFFFF) == FAT32_FREE_CLUSTER;
+    bool now_free = (value & 0x0FFFFFFF) == FAT32_FREE_CLUSTER;
 
-    *(uint32_t*)(f_buf + (fat_offset % 512)) = (value & 0x0FFFFFFF);
+    // 保留高 4 位
+    *entry = (*entry & 0xF0000000) | (value & 0x0FFFFFFF);
 
-    if (write_sector(rel_sector, f_buf) != 0) return false;
-    if (write_sector(rel_sector + 993, f_buf) != 0) return false;
+    if (was_free && !now_free) {
+        free_map_set(cluster);
+        fs_info.free_clusters--;
+    } else if (!was_free && now_free) {
+        free_map_clear(cluster);
+        fs_info.free_clusters++;
+    }
+
+    uint32_t s = (cluster * 4) / 512 - fat_cache_base;
+    fat_cache_dirty[s / 64] |= 1ULL << (s % 64);
 
     return true;
 }
 
+static void free_map_release(void) {
+    if (free_map != NULL) {
+        pmm_free_blocks(free_map, free_map_pages);
+    }
+    free_map = NULL;
+    free_map_pages = 0;
+    free_map_limit = 0;
+}
+
+static bool free_map_build(void) {
+    free_map_release();
 
+    free_map_limit = fs_info.total_clusters;
+    uint32_t words = (free_map_limit + 63) / 64;
+    free_map_pages = (words * 8 + 4095) / 4096;
+    free_map = (uint64_t*)pmm_alloc_blocks(free_map_pages);
+    if (free_map == NULL) {
+        free_map_pages = 0;
+        free_map_limit = 0;
+        set_error("Failed to allocate free cluster bitmap");
+        return false;
+    }
 
+    memset(free_map, 0, words * 8);
 
+    // 簇 0/1 保留；位图末尾多出的位视为已占用
+    free_map_set(0);
+    free_map_set(1);
+    for (uint32_t c = free_map_limit; c < words * 64; c++) {
+        free_map[c / 64] |= 1ULL << (c % 64);
+    }
 
-uint32_t find_free_cluster(void) {
-    for (uint32_t c = 3; c < 127006; c++) {
-        uint32_t entry = read_fat_entry(c);
-        if (entry == 0) {
-            return c;
+    uint32_t free_count = 0;
+    for (uint32_t c = 2; c < free_map_limit; c++) {
+        if (read_fat_entry(c) == FAT32_FREE_CLUSTER) {
+            free_count++;
+        } else {
+            free_map_set(c);
+        }
+    }
+
+    fs_info.free_clusters = free_count;
+    if (next_free_hint < 2 || next_free_hint >= free_map_limit) {
+        next_free_hint = 2;
+    }
+    return true;
+}
+
+// 从 hint 开始找第一个空闲簇，跳过全满的 64 位字
+static uint32_t free_map_scan(uint32_t from, uint32_t to) {
+    uint32_t c = from;
+    while (c < to) {
+        uint64_t word = free_map[c / 64] | ((1ULL << (c % 64)) - 1);
+        if (word != ~0ULL) {
+            uint32_t found = (c & ~63u) + __builtin_ctzll(~word);
+            return found < to ? found : 0;
         }
+        c = (c & ~63u) + 64;
     }
-    return 0x0FFFFFF7;
+    return 0;
+}
+
+uint32_t find_free_cluster(void) {
+    uint32_t run_len;
+    return find_free_run(1, &run_len);
 }
 
+// next-fit 查找连续空闲簇：优先返回长度不小于 want 的第一段，
+// 找不到时返回最长的一段；*run_len 为实际可用长度，无空闲簇返回 0
+static uint32_t find_free_run(uint32_t want, uint32_t* run_len) {
+    *run_len = 0;
+    if (free_map == NULL || fs_info.free_clusters == 0) {
+        return 0;
+    }
+
+    uint32_t best_start = 0;
+    uint32_t best_len = 0;
+    uint32_t hint = next_free_hint;
+
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t from = pass == 0 ? hint : 2;
+        uint32_t to = pass == 0 ? free_map_limit : hint;
 
+        uint32_t c = free_map_scan(from, to);
+        while (c != 0) {
+            uint32_t end = c + 1;
+            while (end < to && end - c < want && !free_map_test(end)) {
+                end++;
+            }
+
+            if (end - c >= want) {
+                *run_len = want;
+                next_free_hint = c + want;
+                return c;
+            }
+
+            if (end - c > best_len) {
+                best_start = c;
+                best_len = end - c;
+            }
 
+            c = free_map_scan(end, to);
+        }
+    }
+
+    if (best_len != 0) {
+        *run_len = best_len;
+        next_free_hint = best_start + best_len;
+    }
+    return best_start;
+}
 
 static bool allocate_cluster_chain(uint32_t* cluster, uint32_t count) {
     uint32_t first_cluster = 0;
     uint32_t prev_cluster = 0;
+    uint32_t allocated = 0;
 
-    for (uint32_t i = 0; i < count; i++) {
-        uint32_t new_cluster = find_free_cluster();
-        if (new_cluster == 0) {
+    while (allocated < count) {
+        uint32_t run_len;
+        uint32_t start = find_free_run(count - allocated, &run_len);
+        if (start == 0) {
             set_error("Not enough free space");
             if (first_cluster != 0) {
                 free_cluster_chain(first_cluster);
@@ -173,23 +468,31 @@ static bool allocate_cluster_chain(uint32_t* cluster, uint32_t count) {
             return false;
         }
 
-        if (!write_fat_entry(new_cluster, FAT32_LAST_CLUSTER)) {
-            if (first_cluster != 0) {
-                free_cluster_chain(first_cluster);
+        // 一段连续簇内部顺序链接
+        for (uint32_t i = 0; i < run_len; i++) {
+            uint32_t next = (i + 1 < run_len) ? start + i + 1 : FAT32_LAST_CLUSTER;
+            if (!write_fat_entry(start + i, next)) {
+                if (first_cluster != 0) {
+                    free_cluster_chain(first_cluster);
+                }
+                if (i != 0) {
+                    write_fat_entry(start + i - 1, FAT32_LAST_CLUSTER);
+                    free_cluster_chain(start);
+                }
+                return false;
             }
-            return false;
         }
 
-        if (i == 0) {
-            first_cluster = new_cluster;
-        } else {
-            if (!write_fat_entry(prev_cluster, new_cluster)) {
-                free_cluster_chain(first_cluster);
-                return false;
-            }
+        if (first_cluster == 0) {
+            first_cluster = start;
+        } else if (!write_fat_entry(prev_cluster, start)) {
+            free_cluster_chain(first_cluster);
+            free_cluster_chain(start);
+            return false;
         }
 
-        prev_cluster = new_cluster;
+        prev_cluster = start + run_len - 1;
+        allocated += run_len;
     }
 
     *cluster = first_cluster;
@@ -197,6 +500,9 @@ static bool allocate_cluster_chain(uint32_t* cluster, uint32_t count) {
 }
 
 static bool free_cluster_chain(uint32_t cluster) {
+    // 首簇号即页缓存中的文件标识，簇被复用前丢弃旧文件的缓存页
+    pcache_invalidate_file(cluster);
+
     while (cluster < FAT32_LAST_CLUSTER) {
         uint32_t next_cluster = read_fat_entry(cluster);
         if (!write_fat_entry(cluster, FAT32_FREE_CLUSTER)) {
@@ -459,11 +765,12 @@ bool fat32_init(uint32_t partition_start_sector) {
 
     uint8_t sector_buffer[512] __attribute__((aligned(16)));
 
-    if (ide_read_sectors(partition_start, 1, sector_buffer) != 0) {
+    if (bcache_read(partition_start, sector_buffer) != 0) {
         return false;
     }
 
     memcpy(&g_bpb, sector_buffer, sizeof(fat32_bpb_t));
+    memcpy(&bpb, sector_buffer, sizeof(fat32_bpb_t));
 
     fs_info.bytes_per_sector = *(uint16_t*)(sector_buffer + 11);
     fs_info.sectors_per_cluster = sector_buffer[13];
@@ -500,6 +807,22 @@ bool fat32_init(uint32_t partition_start_sector) {
     fs_info.total_clusters = 127006;
     bpb.fat_count = 2;
 
+    pcache_invalidate_all();
+    ra_bio_count = 0;
+    ra_page_count = 0;
+    ra_stuck = false;
+    fat_cache_release();
+    if (!fat_cache_init()) {
+        return false;
+    }
+
+    next_free_hint = 2;
+    read_fs_info_sector();
+    if (!free_map_build()) {
+        fat_cache_release();
+        return false;
+    }
+
     fs_mounted = true;
     return true;
 }
@@ -512,11 +835,41 @@ bool fat32_mount(uint32_t partition_start_sector) {
     return fat32_init(partition_start_sector);
 }
 
-void fat32_umount(void) {
+bool fat32_sync(void) {
+    if (!fs_mounted) {
+        return true;
+    }
+
+    if (!fat_cache_flush()) {
+        return false;
+    }
+
+    update_fs_info_sector();
+
+    if (bcache_sync() != 0) {
+        set_error("Failed to flush block cache");
+        return false;
+    }
+
+    return true;
+}
+
+// 回写失败时保持挂载，块缓存里的脏扇区不能丢弃
+bool fat32_umount(void) {
+    if (!fat32_sync()) {
+        return false;
+    }
+
+    free_map_release();
+    fat_cache_release();
+    pcache_invalidate_all();
+    bcache_invalidate();
+
     fs_mounted = false;
     memset(&fs_info, 0, sizeof(fs_info));
     memset(&bpb, 0, sizeof(bpb));
     volume_label[0] = '\0';
+    return true;
 }
 
 
@@ -611,6 +964,238 @@ bool fat32_open_root(fat32_handle_t* handle) {
     return fat32_open("/", handle, FILE_READ);
 }
 
+// 从 cluster 的第 sector_in_cluster 个扇区起，沿物理连续的簇链统计最多 want 个扇区。
+// extend 为真时在链尾追加紧邻的空闲簇 (写路径)。
+static uint32_t contiguous_sectors(uint32_t cluster, uint32_t sector_in_cluster,
+                                   uint32_t want, bool extend) {
+    uint32_t run = fs_info.sectors_per_cluster - sector_in_cluster;
+
+    while (run < want) {
+        uint32_t next = read_fat_entry(cluster);
+        if (next >= FAT32_LAST_CLUSTER && extend &&
+            cluster + 1 < free_map_limit && !free_map_test(cluster + 1)) {
+            if (!write_fat_entry(cluster + 1, FAT32_LAST_CLUSTER)) {
+                break;
+            }
+            if (!write_fat_entry(cluster, cluster + 1)) {
+                write_fat_entry(cluster + 1, FAT32_FREE_CLUSTER);
+                break;
+            }
+            if (next_free_hint <= cluster + 1) {
+                next_free_hint = cluster + 2;
+            }
+            next = cluster + 1;
+        }
+
+        if (next != cluster + 1) {
+            break;
+        }
+
+        cluster = next;
+        run += fs_info.sectors_per_cluster;
+    }
+
+    return run < want ? run : want;
+}
+
+// 文件第 index 页中有效数据的字节数
+static uint32_t page_valid_bytes(fat32_handle_t* handle, uint32_t index) {
+    uint32_t offset = index * PCACHE_PAGE_SIZE;
+    if (offset >= handle->file_size) {
+        return 0;
+    }
+
+    uint32_t n = handle->file_size - offset;
+    return n < PCACHE_PAGE_SIZE ? n : PCACHE_PAGE_SIZE;
+}
+
+static uint32_t next_ra_size(uint32_t size) {
+    if (size < FAT32_RA_INIT / 2) {
+        return FAT32_RA_INIT;
+    }
+    return size * 2 < FAT32_RA_MAX ? size * 2 : FAT32_RA_MAX;
+}
+
+static bool readahead_settled(void) {
+    for (uint32_t i = 0; i < ra_bio_count; i++) {
+        if (!ra_bios[i].done) return false;
+    }
+    return true;
+}
+
+// 等待本批 bio 完成：成功的页记录有效长度，失败的页丢弃。
+// 等待超时先复位设备；仍未完成的 bio 所在页永久移出缓存，bio 数组不再使用
+static void readahead_complete(blkdev_t* dev) {
+    if (ra_bio_count > 0) {
+        blk_drain(dev);
+        if (!readahead_settled()) {
+            blk_abort(dev);
+        }
+    }
+
+    for (uint32_t i = 0; i < ra_bio_count; i++) {
+        uint32_t slot = (uint32_t)((uint32_t*)ra_bios[i].private_data - ra_valid);
+        if (!ra_bios[i].done) {
+            ra_pinned[slot] = true;
+            ra_stuck = true;
+        } else if (ra_bios[i].status != 0) {
+            ra_valid[slot] = 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < ra_page_count; i++) {
+        if (ra_pinned[i]) {
+            pcache_retire(ra_pages[i]);
+            ra_pinned[i] = false;
+        } else if (ra_valid[i] != 0) {
+            pcache_fill_done(ra_pages[i], ra_valid[i]);
+        } else {
+            pcache_drop(ra_pages[i]);
+        }
+    }
+
+    if (ra_stuck) {
+        serial_puts("FAT32: readahead disabled after device timeout\n");
+    }
+
+    ra_bio_count = 0;
+    ra_page_count = 0;
+}
+
+// 读入一页：先把页内各段解析为物理扇区，全部成功后才提交 I/O。
+// 有块设备时只提交 bio，由 readahead_complete 统一等待
+static bool readahead_page(fat32_handle_t* handle, blkdev_t* dev, pcache_page_t* page, uint32_t need) {
+    uint32_t bytes_per_cluster = fs_info.sectors_per_cluster * fs_info.bytes_per_sector;
+    uint32_t total = (need + fs_info.bytes_per_sector - 1) / fs_info.bytes_per_sector;
+    uint32_t seg_sector[FAT32_PAGE_SECTORS];
+    uint32_t seg_count[FAT32_PAGE_SECTORS];
+    uint32_t segs = 0;
+    uint32_t done = 0;
+
+    while (done < total) {
+        uint32_t pos = page->index * PCACHE_PAGE_SIZE + done * fs_info.bytes_per_sector;
+        uint32_t cluster = resolve_file_cluster(handle, pos / bytes_per_cluster);
+        if (cluster == 0) {
+            return false;
+        }
+
+        uint32_t sector_in_cluster = (pos % bytes_per_cluster) / fs_info.bytes_per_sector;
+        uint32_t count = contiguous_sectors(cluster, sector_in_cluster, total - done, false);
+
+        seg_sector[segs] = cluster_to_sector(cluster) + sector_in_cluster;
+        seg_count[segs] = count;
+        segs++;
+        done += count;
+    }
+
+    uint8_t* dest = page->data;
+
+    if (dev == NULL) {
+        for (uint32_t i = 0; i < segs; i++) {
+            if (read_data_sectors(seg_sector[i], seg_count[i], dest) != 0) {
+                return false;
+            }
+            dest += seg_count[i] * fs_info.bytes_per_sector;
+        }
+        pcache_fill_done(page, total * fs_info.bytes_per_sector);
+        return true;
+    }
+
+    // 绕过块缓存直接读盘，先回写范围内的脏扇区
+    for (uint32_t i = 0; i < segs; i++) {
+        if (bcache_flush_range(partition_start + seg_sector[i], seg_count[i]) != 0) {
+            return false;
+        }
+    }
+
+    uint32_t slot = ra_page_count++;
+    ra_pages[slot] = page;
+    ra_valid[slot] = total * fs_info.bytes_per_sector;
+
+    for (uint32_t i = 0; i < segs; i++) {
+        bio_t* bio = &ra_bios[ra_bio_count++];
+        bio_init(bio, partition_start + seg_sector[i], seg_count[i], dest, false);
+        bio->private_data = &ra_valid[slot];
+        submit_bio(dev, bio);
+        dest += seg_count[i] * fs_info.bytes_per_sector;
+    }
+
+    return true;
+}
+
+// 把 [start, start + count) 中尚未缓存的页读入页缓存。各页的 bio 一起提交，
+// 由块设备层按 LBA 排序合并为大请求
+static void file_readahead(fat32_handle_t* handle, uint32_t start, uint32_t count) {
+    blkdev_t* dev = ra_stuck ? NULL : blkdev_get_default();
+
+    for (uint32_t index = start; index - start < count; index++) {
+        uint32_t need = page_valid_bytes(handle, index);
+        if (need == 0) {
+            break;
+        }
+
+        pcache_page_t* page = pcache_grab(handle->first_cluster, index);
+        if (page == NULL) {
+            break;
+        }
+        if (page->valid >= need) {
+            continue;
+        }
+
+        if (dev != NULL && (ra_page_count == FAT32_RA_MAX ||
+                            ra_bio_count + FAT32_PAGE_SECTORS > FAT32_RA_MAX_BIOS)) {
+            readahead_complete(dev);
+        }
+
+        if (!readahead_page(handle, dev, page, need)) {
+            pcache_drop(page);
+            break;
+        }
+    }
+
+    if (dev != NULL) {
+        readahead_complete(dev);
+    }
+}
+
+// 取得文件第 index 页。未命中时读入从 index 开始的预读窗口；顺序读到窗口中部时
+// 读入下一个窗口。两者都在本次调用中等待 I/O 完成，后者只是把读盘提前到真正需要之前
+static pcache_page_t* file_page_get(fat32_handle_t* handle, uint32_t index, uint32_t want_pages) {
+    uint32_t need = page_valid_bytes(handle, index);
+    bool sequential = index == handle->ra_prev || index == handle->ra_prev + 1;
+    handle->ra_prev = index;
+
+    pcache_page_t* page = pcache_lookup(handle->first_cluster, index, need);
+    if (page != NULL) {
+        if (sequential && index == handle->ra_trigger) {
+            uint32_t start = handle->ra_start + handle->ra_size;
+            uint32_t size = next_ra_size(handle->ra_size);
+
+            handle->ra_start = start;
+            handle->ra_size = size;
+            handle->ra_trigger = start + size / 2;
+            file_readahead(handle, start, size);
+        }
+        return page;
+    }
+
+    uint32_t size = (sequential || index == 0) ? next_ra_size(handle->ra_size) : 1;
+    if (size < want_pages) {
+        size = want_pages < FAT32_RA_MAX ? want_pages : FAT32_RA_MAX;
+    }
+
+    handle->ra_start = index;
+    handle->ra_size = size;
+    handle->ra_trigger = size > 1 ? index + size / 2 : 0xFFFFFFFF;
+    file_readahead(handle, index, size);
+
+    page = pcache_grab(handle->first_cluster, index);
+    if (page == NULL || page->valid < need) {
+        return NULL;
+    }
+    return page;
+}
+
 bool fat32_read(fat32_handle_t* handle, void* buffer, uint32_t size) {
     clear_error();
 
@@ -632,49 +1217,54 @@ bool fat32_read(fat32_handle_t* handle, void* buffer, uint32_t size) {
         size = handle->file_size - handle->position;
     }
 
+    // 句柄缓冲区中尚未写回的扇区先写入块缓存，页缓存从磁盘填充时才能看到
+    if (handle->buffer_dirty && handle->buffer_sector != 0) {
+        if (write_sector(handle->buffer_sector, handle->buffer) != 0) {
+            set_error("Failed to write sector");
+            return false;
+        }
+        handle->buffer_dirty = false;
+    }
+
     uint8_t* dest = (uint8_t*)buffer;
     uint32_t bytes_read = 0;
 
+    // 经页缓存读取，同一文件的所有句柄共享缓存页
     while (bytes_read < size) {
-        uint32_t cluster_offset = handle->position % (fs_info.sectors_per_cluster * fs_info.bytes_per_sector);
-        uint32_t sector_in_cluster = cluster_offset / fs_info.bytes_per_sector;
-        uint32_t sector_offset = cluster_offset % fs_info.bytes_per_sector;
-
-        if (cluster_offset == 0 && handle->position > 0) {
-            handle->current_cluster = read_fat_entry(handle->current_cluster);
-            if (handle->current_cluster >= FAT32_LAST_CLUSTER) {
-                break;
-            }
-        }
+        uint32_t index = handle->position / PCACHE_PAGE_SIZE;
+        uint32_t page_offset = handle->position % PCACHE_PAGE_SIZE;
+        uint32_t want_pages = (page_offset + size - bytes_read + PCACHE_PAGE_SIZE - 1) / PCACHE_PAGE_SIZE;
 
-        uint32_t sector = cluster_to_sector(handle->current_cluster) + sector_in_cluster;
-        if (sector != handle->buffer_sector) {
-            if (read_sector(sector, handle->buffer) != 0) {
-                set_error("Failed to read sector");
-                return false;
-            }
-            handle->buffer_sector = sector;
+        pcache_page_t* page = file_page_get(handle, index, want_pages);
+        if (page == NULL) {
+            set_error("Failed to read sector");
+            return false;
         }
 
-        uint32_t bytes_to_read = fs_info.bytes_per_sector - sector_offset;
+        uint32_t bytes_to_read = PCACHE_PAGE_SIZE - page_offset;
         if (bytes_to_read > size - bytes_read) {
             bytes_to_read = size - bytes_read;
         }
 
-        memcpy(dest + bytes_read, handle->buffer + sector_offset, bytes_to_read);
+        memcpy(dest + bytes_read, page->data + page_offset, bytes_to_read);
 
         bytes_read += bytes_to_read;
         handle->position += bytes_to_read;
+    }
 
-        if (sector_offset + bytes_to_read == fs_info.bytes_per_sector) {
-            handle->buffer_sector = 0;
+    // 读写循环在簇边界处才前进到下一簇，因此 current_cluster 对应 position - 1 所在的簇
+    if (handle->position > 0) {
+        uint32_t bytes_per_cluster = fs_info.sectors_per_cluster * fs_info.bytes_per_sector;
+        uint32_t cluster = resolve_file_cluster(handle, (handle->position - 1) / bytes_per_cluster);
+        if (cluster != 0) {
+            handle->current_cluster = cluster;
         }
     }
 
     return bytes_read > 0;
 }
 
-bool fat32_write(fat32_handle_t* handle, const void* buffer, uint32_t size) {
+static bool write_file_data(fat32_handle_t* handle, const void* buffer, uint32_t size) {
     clear_error();
 
     if (!fs_mounted || handle == NULL || buffer == NULL || !handle->is_open || fs_readonly) {
@@ -711,13 +1301,39 @@ bool fat32_write(fat32_handle_t* handle, const void* buffer, uint32_t size) {
                 }
 
                 handle->current_cluster = new_cluster;
-                fs_info.free_clusters--;
             } else {
                 handle->current_cluster = next_cluster;
             }
         }
 
         uint32_t sector = cluster_to_sector(handle->current_cluster) + sector_in_cluster;
+
+        // 大块扇区对齐写：沿连续簇 (必要时追加紧邻空闲簇) 合并为多扇区传输
+        if (sector_offset == 0 && size - bytes_written >= fs_info.bytes_per_sector) {
+            uint32_t want = (size - bytes_written) / fs_info.bytes_per_sector;
+            uint32_t count = contiguous_sectors(handle->current_cluster, sector_in_cluster, want, true);
+
+            // 句柄缓冲区中的扇区若将被覆盖则直接丢弃
+            if (handle->buffer_sector >= sector && handle->buffer_sector - sector < count) {
+                handle->buffer_sector = 0;
+                handle->buffer_dirty = false;
+            }
+
+            if (write_data_sectors(sector, count, src + bytes_written) != 0) {
+                set_error("Failed to write sector");
+                return false;
+            }
+
+            bytes_written += count * fs_info.bytes_per_sector;
+            handle->position += count * fs_info.bytes_per_sector;
+            handle->current_cluster += (sector_in_cluster + count - 1) / fs_info.sectors_per_cluster;
+
+            if (handle->position > handle->file_size) {
+                handle->file_size = handle->position;
+            }
+            continue;
+        }
+
         if (sector != handle->buffer_sector) {
             if (handle->buffer_dirty && handle->buffer_sector != 0) {
                 if (write_sector(handle->buffer_sector, handle->buffer) != 0) {
@@ -758,6 +1374,83 @@ bool fat32_write(fat32_handle_t* handle, const void* buffer, uint32_t size) {
     return true;
 }
 
+bool fat32_write(fat32_handle_t* handle, const void* buffer, uint32_t size) {
+    if (handle == NULL || !handle->is_open || handle->is_directory) {
+        return write_file_data(handle, buffer, size);
+    }
+
+    uint32_t start = handle->position;
+    bool ok = write_file_data(handle, buffer, size);
+
+    // 句柄缓冲区写入块缓存，再使写过的页失效，之后任一句柄重新填充时都能读到新数据
+    if (handle->buffer_dirty && handle->buffer_sector != 0 &&
+        write_sector(handle->buffer_sector, handle->buffer) == 0) {
+        handle->buffer_dirty = false;
+    }
+
+    if (handle->position > start) {
+        uint32_t first = start / PCACHE_PAGE_SIZE;
+        uint32_t last = (handle->position - 1) / PCACHE_PAGE_SIZE;
+        pcache_invalidate_range(handle->first_cluster, first, last - first + 1);
+    }
+
+    return ok;
+}
+
+// 在句柄的 extent 表中二分查找第 index 个簇，未覆盖时沿 FAT 链继续构建。
+// 表满后不再记录新的 extent，超出部分退化为逐簇遍历。返回 0 表示链在此之前结束。
+static uint32_t resolve_file_cluster(fat32_handle_t* handle, uint32_t index) {
+    if (handle->extent_count == 0) {
+        if (handle->first_cluster < 2 || handle->first_cluster >= FAT32_LAST_CLUSTER) {
+            return 0;
+        }
+        handle->extents[0].file_cluster = 0;
+        handle->extents[0].start_cluster = handle->first_cluster;
+        handle->extents[0].length = 1;
+        handle->extent_count = 1;
+    }
+
+    uint32_t lo = 0;
+    uint32_t hi = handle->extent_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        fat32_extent_t* ext = &handle->extents[mid];
+        if (index < ext->file_cluster) {
+            hi = mid;
+        } else if (index - ext->file_cluster >= ext->length) {
+            lo = mid + 1;
+        } else {
+            return ext->start_cluster + (index - ext->file_cluster);
+        }
+    }
+
+    fat32_extent_t* last = &handle->extents[handle->extent_count - 1];
+    uint32_t pos = last->file_cluster + last->length - 1;
+    uint32_t cluster = last->start_cluster + last->length - 1;
+
+    while (pos < index) {
+        uint32_t next = read_fat_entry(cluster);
+        if (next >= FAT32_LAST_CLUSTER || next == FAT32_FREE_CLUSTER) {
+            return 0;
+        }
+
+        pos++;
+        last = &handle->extents[handle->extent_count - 1];
+        if (last->file_cluster + last->length == pos && next == cluster + 1) {
+            last->length++;
+        } else if (last->file_cluster + last->length == pos &&
+                   handle->extent_count < FAT32_MAX_EXTENTS) {
+            fat32_extent_t* ext = &handle->extents[handle->extent_count++];
+            ext->file_cluster = pos;
+            ext->start_cluster = next;
+            ext->length = 1;
+        }
+        cluster = next;
+    }
+
+    return cluster;
+}
+
 bool fat32_seek(fat32_handle_t* handle, uint32_t position) {
     clear_error();
 
@@ -771,6 +1464,14 @@ bool fat32_seek(fat32_handle_t* handle, uint32_t position) {
         return false;
     }
 
+    if (handle->buffer_dirty && handle->buffer_sector != 0) {
+        if (write_sector(handle->buffer_sector, handle->buffer) != 0) {
+            set_error("Failed to write sector");
+            return false;
+        }
+        handle->buffer_dirty = false;
+    }
+
     if (position == 0) {
         handle->current_cluster = handle->first_cluster;
         handle->position = 0;
@@ -779,18 +1480,14 @@ bool fat32_seek(fat32_handle_t* handle, uint32_t position) {
         return true;
     }
 
+    // 读写循环在簇边界处才前进到下一簇，因此边界位置对应前一个簇
     uint32_t bytes_per_cluster = fs_info.sectors_per_cluster * fs_info.bytes_per_sector;
-    uint32_t target_cluster_offset = position / bytes_per_cluster;
-    uint32_t target_sector_offset = (position % bytes_per_cluster) / fs_info.bytes_per_sector;
+    uint32_t target_index = (position - 1) / bytes_per_cluster;
 
-    uint32_t current_cluster = handle->first_cluster;
-    for (uint32_t i = 0; i < target_cluster_offset; i++) {
-        uint32_t next_cluster = read_fat_entry(current_cluster);
-        if (next_cluster >= FAT32_LAST_CLUSTER || next_cluster == FAT32_FREE_CLUSTER) {
-            set_error("Invalid cluster chain");
-            return false;
-        }
-        current_cluster = next_cluster;
+    uint32_t current_cluster = resolve_file_cluster(handle, target_index);
+    if (current_cluster == 0) {
+        set_error("Invalid cluster chain");
+        return false;
     }
 
     handle->current_cluster = current_cluster;
@@ -818,6 +1515,9 @@ bool fat32_truncate(fat32_handle_t* handle, uint32_t new_size) {
         return true;
     }
 
+    uint32_t keep = new_size < handle->file_size ? new_size : handle->file_size;
+    pcache_invalidate_range(handle->first_cluster, keep / PCACHE_PAGE_SIZE, 0xFFFFFFFF);
+
     if (new_size > handle->file_size) {
         uint32_t old_size = handle->file_size;
         handle->file_size = new_size;
@@ -856,6 +1556,7 @@ bool fat32_truncate(fat32_handle_t* handle, uint32_t new_size) {
         }
 
         handle->file_size = new_size;
+        handle->extent_count = 0;
 
         if (handle->position > new_size) {
             handle->position = new_size;
@@ -1546,8 +2247,7 @@ static void update_fs_info_sector(void) {
 
     *((uint32_t*)(fsinfo_sector + 0x1E8)) = fs_info.free_clusters;
 
-    uint32_t next_free = find_free_cluster();
-    *((uint32_t*)(fsinfo_sector + 0x1EC)) = next_free;
+    *((uint32_t*)(fsinfo_sector + 0x1EC)) = next_free_hint;
 
     fsinfo_sector[0x1FC] = 0x55;
     fsinfo_sector[0x1FD] = 0xAA;
@@ -1572,6 +2272,9 @@ static bool read_fs_info_sector(void) {
 
     fs_info.free_clusters = *((uint32_t*)(fsinfo_sector + 0x1E8));
 
+    // 0xFFFFFFFF 表示未知，由 free_map_build() 校正
+    next_free_hint = *((uint32_t*)(fsinfo_sector + 0x1EC));
+
     return true;
 }
 
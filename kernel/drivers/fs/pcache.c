@@ -0,0 +1,210 @@
+#include "drivers/fs/pcache.h"
+#include "pmm.h"
+#include "serial.h"
+#include "string.h"
+
+// 缓存页按 (文件, 页号) 哈希索引，同时挂在 LRU 双向链表上。
+// 页面数据在第一次使用时分配，失效的页保留数据页以便复用
+static pcache_page_t pages[PCACHE_PAGES];
+static pcache_page_t* hash_table[PCACHE_HASH_BUCKETS];
+
+// LRU 链表：头部最近使用，尾部最久未使用
+static pcache_page_t* lru_head = NULL;
+static pcache_page_t* lru_tail = NULL;
+
+static pcache_stats_t stats;
+static bool pcache_ready = false;
+
+static inline uint32_t pcache_hash(uint32_t file, uint32_t index) {
+    return (file * 31 + index) & (PCACHE_HASH_BUCKETS - 1);
+}
+
+static void lru_unlink(pcache_page_t* p) {
+    if (p->lru_prev) p->lru_prev->lru_next = p->lru_next;
+    else lru_head = p->lru_next;
+
+    if (p->lru_next) p->lru_next->lru_prev = p->lru_prev;
+    else lru_tail = p->lru_prev;
+
+    p->lru_prev = NULL;
+    p->lru_next = NULL;
+}
+
+static void lru_push_front(pcache_page_t* p) {
+    p->lru_prev = NULL;
+    p->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = p;
+    lru_head = p;
+    if (!lru_tail) lru_tail = p;
+}
+
+static void lru_push_back(pcache_page_t* p) {
+    p->lru_next = NULL;
+    p->lru_prev = lru_tail;
+    if (lru_tail) lru_tail->lru_next = p;
+    lru_tail = p;
+    if (!lru_head) lru_head = p;
+}
+
+static void lru_touch(pcache_page_t* p) {
+    if (lru_head == p) return;
+    lru_unlink(p);
+    lru_push_front(p);
+}
+
+static void hash_insert(pcache_page_t* p) {
+    uint32_t h = pcache_hash(p->file, p->index);
+    p->hash_next = hash_table[h];
+    hash_table[h] = p;
+}
+
+static void hash_remove(pcache_page_t* p) {
+    pcache_page_t** pp = &hash_table[pcache_hash(p->file, p->index)];
+    while (*pp) {
+        if (*pp == p) {
+            *pp = p->hash_next;
+            p->hash_next = NULL;
+            return;
+        }
+        pp = &(*pp)->hash_next;
+    }
+}
+
+static pcache_page_t* pcache_find(uint32_t file, uint32_t index) {
+    pcache_page_t* p = hash_table[pcache_hash(file, index)];
+    while (p) {
+        if (p->cached && p->file == file && p->index == index) return p;
+        p = p->hash_next;
+    }
+    return NULL;
+}
+
+void pcache_init(void) {
+    memset(pages, 0, sizeof(pages));
+    memset(hash_table, 0, sizeof(hash_table));
+    memset(&stats, 0, sizeof(stats));
+
+    lru_head = NULL;
+    lru_tail = NULL;
+    for (int i = 0; i < PCACHE_PAGES; i++) {
+        lru_push_front(&pages[i]);
+    }
+
+    pcache_ready = true;
+
+    serial_puts("Page cache initialized (");
+    serial_putdec64(PCACHE_PAGES);
+    serial_puts(" pages)\n");
+}
+
+pcache_page_t* pcache_lookup(uint32_t file, uint32_t index, uint32_t min_valid) {
+    if (!pcache_ready) pcache_init();
+
+    pcache_page_t* p = pcache_find(file, index);
+    if (p && p->valid > 0 && p->valid >= min_valid) {
+        stats.hits++;
+        lru_touch(p);
+        return p;
+    }
+
+    stats.misses++;
+    return NULL;
+}
+
+pcache_page_t* pcache_grab(uint32_t file, uint32_t index) {
+    if (!pcache_ready) pcache_init();
+
+    pcache_page_t* p = pcache_find(file, index);
+    if (p) {
+        lru_touch(p);
+        return p;
+    }
+
+    p = lru_tail;
+    if (!p) return NULL;
+    if (!p->data) {
+        p->data = (uint8_t*)pmm_alloc_page();
+        if (!p->data) return NULL;
+    }
+
+    if (p->cached) {
+        hash_remove(p);
+        stats.cached--;
+        stats.evictions++;
+    }
+
+    p->file = file;
+    p->index = index;
+    p->valid = 0;
+    p->cached = true;
+    hash_insert(p);
+    lru_touch(p);
+    stats.cached++;
+    return p;
+}
+
+void pcache_fill_done(pcache_page_t* page, uint32_t valid) {
+    page->valid = valid;
+    stats.fills++;
+}
+
+// 丢弃缓存页，放到 LRU 尾部优先复用
+void pcache_drop(pcache_page_t* page) {
+    if (!page->cached) return;
+
+    hash_remove(page);
+    page->cached = false;
+    page->valid = 0;
+    stats.cached--;
+    lru_unlink(page);
+    lru_push_back(page);
+}
+
+// 从哈希表和 LRU 链表中摘除，LRU 外的页不会再被 pcache_grab 选中
+void pcache_retire(pcache_page_t* page) {
+    if (page->cached) {
+        hash_remove(page);
+        page->cached = false;
+        stats.cached--;
+    }
+    page->valid = 0;
+    lru_unlink(page);
+}
+
+void pcache_invalidate_file(uint32_t file) {
+    if (!pcache_ready) return;
+
+    for (int i = 0; i < PCACHE_PAGES; i++) {
+        if (pages[i].cached && pages[i].file == file) {
+            pcache_drop(&pages[i]);
+        }
+    }
+}
+
+// 使 [first, first + count) 范围内的页失效
+void pcache_invalidate_range(uint32_t file, uint32_t first, uint32_t count) {
+    if (!pcache_ready) return;
+
+    for (int i = 0; i < PCACHE_PAGES; i++) {
+        pcache_page_t* p = &pages[i];
+        if (p->cached && p->file == file && p->index >= first && p->index - first < count) {
+            pcache_drop(p);
+        }
+    }
+}
+
+void pcache_invalidate_all(void) {
+    if (!pcache_ready) return;
+
+    for (int i = 0; i < PCACHE_PAGES; i++) {
+        if (pages[i].cached) {
+            pcache_drop(&pages[i]);
+        }
+    }
+}
+
+void pcache_get_stats(pcache_stats_t* out) {
+    if (out) {
+        *out = stats;
+    }
+}
@@ -22,8 +22,34 @@
 */
 
 #include "drivers/ide.h"
+#include "drivers/pci.h"
+#include "drivers/pic.h"
 #include "serial.h"
 #include "io.h"
+#include "idt.h"
+#include "timer.h"
+#include "pmm.h"
+#include "vmm.h"
+
+// 物理区域描述符 (PRD)，每项不能跨越 64KB 边界
+typedef struct __attribute__((packed)) {
+    uint32_t phys_addr;
+    uint16_t byte_count;    // 0 表示 64KB
+    uint16_t flags;
+} ide_prd_t;
+
+#define IDE_PRD_EOT     0x8000
+#define IDE_PRD_MAX     (4096 / sizeof(ide_prd_t))
+
+static uint16_t bm_base = 0;
+static ide_prd_t* prd_table = NULL;
+static bool dma_enabled = false;
+static volatile bool ide_irq_fired = false;
+
+// 由 ide_identify() 填充
+static bool ide_lba48 = false;
+static uint64_t ide_total_sectors = 0;
+static uint8_t ide_multiple = 0;    // 0 表示未启用 MULTIPLE 模式
 
 /*static inline uint8_t inb(uint16_t port) {
     uint8_t ret;
@@ -124,86 +150,340 @@ void ide_init(void) {
 
     ide_wait_ready();
 
+    ide_lba48 = false;
+    ide_total_sectors = 0;
+    ide_multiple = 0;
+    ide_identify();
+
+    ide_dma_init();
+
     serial_puts("IDE controller initialized successfully\n");
 }
 
-int ide_read_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
-    /*serial_puts("Reading LBA...");
-    serial_putdec64(lba);
-    serial_puts("\n");*/
-    uint16_t* buf = (uint16_t*)buffer;
+static void ide_irq_handler(interrupt_frame_t* frame) {
+    // 读状态寄存器以清除设备中断
+    inb(IDE_STATUS);
+    ide_irq_fired = true;
+}
 
-    ide_wait_ready();
+int ide_dma_init(void) {
+    pci_device_t pdev;
+
+    // 大容量存储控制器 / IDE 控制器，prog_if 第 7 位表示支持总线主控
+    if (!pci_find_class(0x01, 0x01, &pdev) || !(pdev.prog_if & 0x80)) {
+        serial_puts("IDE: no bus-master controller, using PIO\n");
+        return -1;
+    }
+
+    uint32_t bar4 = pci_read_bar(&pdev, 4);
+    if (!(bar4 & 1) || (bar4 & 0xFFFC) == 0) {
+        serial_puts("IDE: invalid bus-master BAR, using PIO\n");
+        return -1;
+    }
+
+    prd_table = (ide_prd_t*)pmm_alloc_zpage();
+    if (prd_table == NULL || (uint64_t)prd_table >= 0x100000000ULL) {
+        serial_puts("IDE: cannot allocate PRD table, using PIO\n");
+        if (prd_table) pmm_free_page(prd_table);
+        prd_table = NULL;
+        return -1;
+    }
+
+    bm_base = bar4 & 0xFFFC;
+    pci_enable_bus_master(&pdev);
+
+    register_interrupt_handler(IDE_IRQ_VECTOR, ide_irq_handler);
+    pic_enable_irq(IDE_IRQ);
+
+    // 清除 nIEN，允许设备产生中断
+    outb(IDE_DEV_CTRL, 0x00);
+
+    dma_enabled = true;
+
+    serial_puts("IDE: bus-master DMA enabled at I/O 0x");
+    serial_puthex16(bm_base);
+    serial_puts("\n");
+    return 0;
+}
+
+// 按 64KB 边界切分调用者缓冲区生成 PRD 表 (缓冲区可能位于内核映像中，需换算物理地址)
+static bool ide_dma_build_prdt(void* buffer, uint32_t bytes) {
+    uint64_t addr = vmm_dma_addr(buffer, bytes);
+
+    // 物理不连续的缓冲区 (按需堆) 退回 PIO
+    if (addr == 0 || (addr & 1) || addr + bytes > 0x100000000ULL) {
+        return false;
+    }
+
+    uint32_t n = 0;
+    while (bytes > 0) {
+        if (n >= IDE_PRD_MAX) return false;
+
+        uint32_t chunk = 0x10000 - (addr & 0xFFFF);
+        if (chunk > bytes) chunk = bytes;
+
+        prd_table[n].phys_addr = (uint32_t)addr;
+        prd_table[n].byte_count = (uint16_t)(chunk & 0xFFFF);
+        prd_table[n].flags = 0;
+
+        addr += chunk;
+        bytes -= chunk;
+        n++;
+    }
+
+    prd_table[n - 1].flags = IDE_PRD_EOT;
+    return true;
+}
+
+// 等待 DMA 完成：开中断时 hlt 等待 IRQ14，否则轮询总线主控状态
+static int ide_dma_wait(void) {
+    uint64_t rflags;
+    asm volatile("pushfq; pop %0" : "=r"(rflags));
+    bool can_halt = (rflags & 0x200) != 0;
+
+    uint64_t deadline = timer_get_ticks() + 5000;
+    uint32_t spins = 10000000;
 
-    outb(IDE_DRIVE_HEAD, defult_device | IDE_LBA_MODE | ((lba >> 24) & 0x0F));
-    outb(IDE_SECTOR_CNT, num_sectors);
+    while (1) {
+        uint8_t bm_status = inb(bm_base + IDE_BM_STATUS);
+        if (ide_irq_fired || (bm_status & (IDE_BM_STATUS_IRQ | IDE_BM_STATUS_ERR))) {
+            break;
+        }
+
+        if (can_halt) {
+            if (timer_get_ticks() > deadline) return -1;
+            // 关中断后再查一次标志：若中断恰好落在上面的检查与 hlt 之间，
+            // 直接 hlt 会错过唤醒。sti 的后一条指令执行完才响应中断，
+            // "sti; hlt" 之间不会再漏掉
+            asm volatile("cli" : : : "memory");
+            if (ide_irq_fired) {
+                asm volatile("sti" : : : "memory");
+                break;
+            }
+            asm volatile("sti; hlt" : : : "memory");
+        } else if (--spins == 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// 写入 LBA 与扇区数：48 位命令先写高字节再写低字节
+static void ide_setup_lba(uint8_t drive, uint64_t lba, uint32_t count, bool ext) {
+    if (ext) {
+        outb(IDE_DRIVE_HEAD, drive);
+        outb(IDE_SECTOR_CNT, (count >> 8) & 0xFF);
+        outb(IDE_LBA_LOW, (lba >> 24) & 0xFF);
+        outb(IDE_LBA_MID, (lba >> 32) & 0xFF);
+        outb(IDE_LBA_HIGH, (lba >> 40) & 0xFF);
+    } else {
+        outb(IDE_DRIVE_HEAD, drive | ((lba >> 24) & 0x0F));
+    }
+    outb(IDE_SECTOR_CNT, count & 0xFF);
     outb(IDE_LBA_LOW, lba & 0xFF);
     outb(IDE_LBA_MID, (lba >> 8) & 0xFF);
     outb(IDE_LBA_HIGH, (lba >> 16) & 0xFF);
+}
 
-    outb(IDE_COMMAND, IDE_CMD_READ);
+// 28 位地址够用且扇区数不超过 256 时仍使用短命令
+static inline bool ide_need_ext(uint64_t lba, uint32_t count) {
+    return ide_lba48 && (lba + count > IDE_LBA28_LIMIT || count > 256);
+}
 
-    for (int sector = 0; sector < num_sectors; sector++) {
-        if (ide_wait_drq() != 0) {
-            serial_puts("Read failed: DRQ not set\n");
-            return -1;
-        }
+static int ide_flush_cache(void) {
+    outb(IDE_COMMAND, ide_lba48 ? IDE_CMD_FLUSH_EXT : IDE_CMD_FLUSH);
+    return ide_wait_ready();
+}
 
+static int ide_dma_transfer(uint64_t lba, uint32_t num_sectors, void* buffer, bool write) {
+    if (ide_wait_ready() != 0) return -1;
 
-        for (int i = 0; i < 256; i++) {
-            buf[i] = inw(IDE_DATA);
-        }
-        buf += 256;
+    bool ext = ide_need_ext(lba, num_sectors);
 
-        io_wait();
+    outb(bm_base + IDE_BM_COMMAND, 0);
+    outl(bm_base + IDE_BM_PRDT, (uint32_t)(uint64_t)prd_table);
+    outb(bm_base + IDE_BM_STATUS, IDE_BM_STATUS_IRQ | IDE_BM_STATUS_ERR);
+
+    uint8_t direction = write ? 0 : IDE_BM_CMD_READ;
+    outb(bm_base + IDE_BM_COMMAND, direction);
+
+    ide_irq_fired = false;
+
+    uint8_t drive = write ? 0xE0 : (defult_device | IDE_LBA_MODE);
+    ide_setup_lba(drive, lba, num_sectors, ext);
+    if (ext) {
+        outb(IDE_COMMAND, write ? IDE_CMD_WRITE_DMA_EXT : IDE_CMD_READ_DMA_EXT);
+    } else {
+        outb(IDE_COMMAND, write ? IDE_CMD_WRITE_DMA : IDE_CMD_READ_DMA);
+    }
+
+    outb(bm_base + IDE_BM_COMMAND, direction | IDE_BM_CMD_START);
+
+    int result = ide_dma_wait();
+
+    outb(bm_base + IDE_BM_COMMAND, 0);
+    uint8_t bm_status = inb(bm_base + IDE_BM_STATUS);
+    outb(bm_base + IDE_BM_STATUS, IDE_BM_STATUS_IRQ | IDE_BM_STATUS_ERR);
+
+    if (result != 0) {
+        serial_puts("IDE DMA timeout at LBA ");
+        serial_putdec64(lba);
+        serial_puts("\n");
+        return -1;
+    }
+
+    if ((bm_status & IDE_BM_STATUS_ERR) || ide_wait_ready() != 0) {
+        serial_puts("IDE DMA error at LBA ");
+        serial_putdec64(lba);
+        serial_puts("\n");
+        return -1;
     }
 
     return 0;
 }
 
-int ide_write_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
+// PIO 传输：启用 MULTIPLE 模式时每个 DRQ 块传输 ide_multiple 个扇区
+static int ide_pio_transfer(uint64_t lba, uint32_t num_sectors, void* buffer, bool write) {
     uint16_t* buf = (uint16_t*)buffer;
-
-    serial_puts("IDE Write -> LBA: ");
-    serial_putdec64(lba);
-    serial_puts(", Count: ");
-    serial_putdec64(num_sectors);
-    serial_puts("\n");
-
-    if (num_sectors == 0) return -1;
+    bool ext = ide_need_ext(lba, num_sectors);
+    uint32_t block = ide_multiple ? ide_multiple : 1;
+    uint8_t command;
 
     if (ide_wait_ready() != 0) return -1;
 
-    outb(IDE_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
-    outb(IDE_SECTOR_CNT, num_sectors);
-    outb(IDE_LBA_LOW, lba & 0xFF);
-    outb(IDE_LBA_MID, (lba >> 8) & 0xFF);
-    outb(IDE_LBA_HIGH, (lba >> 16) & 0xFF);
+    if (write) {
+        if (ide_multiple) command = ext ? IDE_CMD_WRITE_MULTIPLE_EXT : IDE_CMD_WRITE_MULTIPLE;
+        else command = ext ? IDE_CMD_WRITE_EXT : IDE_CMD_WRITE;
+        ide_setup_lba(0xE0, lba, num_sectors, ext);
+    } else {
+        if (ide_multiple) command = ext ? IDE_CMD_READ_MULTIPLE_EXT : IDE_CMD_READ_MULTIPLE;
+        else command = ext ? IDE_CMD_READ_EXT : IDE_CMD_READ;
+        ide_setup_lba(defult_device | IDE_LBA_MODE, lba, num_sectors, ext);
+    }
 
-    outb(IDE_COMMAND, IDE_CMD_WRITE);
+    outb(IDE_COMMAND, command);
+
+    uint32_t done = 0;
+    while (done < num_sectors) {
+        uint32_t n = num_sectors - done;
+        if (n > block) n = block;
 
-    for (int sector = 0; sector < num_sectors; sector++) {
         if (ide_wait_drq() != 0) {
-            serial_puts("Write failed at sector ");
-            serial_putdec64(sector);
+            serial_puts(write ? "Write failed at sector " : "Read failed at sector ");
+            serial_putdec64(lba + done);
             serial_puts("\n");
             return -1;
         }
 
-        for (int i = 0; i < 256; i++) {
-            outw(IDE_DATA, buf[i]);
+        uint32_t words = n * 256;
+        if (write) {
+            for (uint32_t i = 0; i < words; i++) {
+                outw(IDE_DATA, buf[i]);
+            }
+        } else {
+            for (uint32_t i = 0; i < words; i++) {
+                buf[i] = inw(IDE_DATA);
+            }
         }
-        buf += 256;
+        buf += words;
+        done += n;
 
         io_wait();
     }
 
-    outb(IDE_COMMAND, 0xE7);
-    ide_wait_ready();
+    if (write) return ide_flush_cache();
+    return 0;
+}
+
+int ide_read_sectors_ext(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    if (num_sectors == 0) return -1;
+    if (!ide_lba48 && lba + num_sectors > IDE_LBA28_LIMIT) return -1;
+
+    uint8_t* buf = (uint8_t*)buffer;
+    uint32_t max = ide_lba48 ? IDE_LBA48_MAX_SECTORS : 256;
+
+    while (num_sectors > 0) {
+        uint32_t n = num_sectors > max ? max : num_sectors;
+        int result;
+
+        if (dma_enabled) {
+            if (n > IDE_DMA_MAX_SECTORS) n = IDE_DMA_MAX_SECTORS;
+        }
+
+        if (dma_enabled && ide_dma_build_prdt(buf, n * 512)) {
+            result = ide_dma_transfer(lba, n, buf, false);
+        } else {
+            result = ide_pio_transfer(lba, n, buf, false);
+        }
+        if (result != 0) return -1;
+
+        lba += n;
+        buf += n * 512;
+        num_sectors -= n;
+    }
 
     return 0;
 }
 
+int ide_write_sectors_ext(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    if (num_sectors == 0) return -1;
+    if (!ide_lba48 && lba + num_sectors > IDE_LBA28_LIMIT) return -1;
+
+    uint8_t* buf = (uint8_t*)buffer;
+    uint32_t max = ide_lba48 ? IDE_LBA48_MAX_SECTORS : 256;
+
+    while (num_sectors > 0) {
+        uint32_t n = num_sectors > max ? max : num_sectors;
+        int result;
+
+        if (dma_enabled) {
+            if (n > IDE_DMA_MAX_SECTORS) n = IDE_DMA_MAX_SECTORS;
+        }
+
+        if (dma_enabled && ide_dma_build_prdt(buf, n * 512)) {
+            result = ide_dma_transfer(lba, n, buf, true);
+            if (result == 0) result = ide_flush_cache();
+        } else {
+            result = ide_pio_transfer(lba, n, buf, true);
+        }
+        if (result != 0) return -1;
+
+        lba += n;
+        buf += n * 512;
+        num_sectors -= n;
+    }
+
+    return 0;
+}
+
+int ide_read_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
+    return ide_read_sectors_ext(lba, num_sectors, buffer);
+}
+
+int ide_write_sectors(uint32_t lba, uint8_t num_sectors, void* buffer) {
+    return ide_write_sectors_ext(lba, num_sectors, buffer);
+}
+
+// 启用 READ/WRITE MULTIPLE：每个 DRQ 块的扇区数取设备上限内最大的 2 的幂
+static void ide_set_multiple(uint8_t max_per_block) {
+    uint8_t count = 1;
+    while ((uint16_t)count * 2 <= max_per_block && count < 128) {
+        count *= 2;
+    }
+
+    if (count < 2 || ide_wait_ready() != 0) {
+        ide_multiple = 0;
+        return;
+    }
+
+    outb(IDE_DRIVE_HEAD, defult_device | IDE_LBA_MODE);
+    outb(IDE_SECTOR_CNT, count);
+    outb(IDE_COMMAND, IDE_CMD_SET_MULTIPLE);
+
+    ide_multiple = ide_wait_ready() == 0 ? count : 0;
+}
+
 void ide_identify(void) {
     uint16_t buffer[256];
 
@@ -224,7 +504,10 @@ void ide_identify(void) {
         return;
     }
 
-    ide_wait_drq();
+    if (ide_wait_drq() != 0) {
+        serial_puts("IDE identify failed\n");
+        return;
+    }
 
     for (int i = 0; i < 256; i++) {
         buffer[i] = inw(IDE_DATA);
@@ -246,20 +529,30 @@ void ide_identify(void) {
     serial_puts(model);
     serial_puts("\n");
 
-    uint32_t sectors = *(uint32_t*)&buffer[60];
-    serial_puts("Total Sectors: ");
+    // 字 83 第 10 位：支持 48 位地址，此时容量取字 100-103
+    ide_lba48 = (buffer[83] & (1 << 10)) != 0;
+    if (ide_lba48) {
+        ide_total_sectors = (uint64_t)buffer[100] |
+                            ((uint64_t)buffer[101] << 16) |
+                            ((uint64_t)buffer[102] << 32) |
+                            ((uint64_t)buffer[103] << 48);
+    } else {
+        ide_total_sectors = (uint32_t)buffer[60] | ((uint32_t)buffer[61] << 16);
+    }
 
-    char num_str[12];
-    int n = 0;
-    uint32_t temp = sectors;
-    do {
-        num_str[n++] = '0' + (temp % 10);
-        temp /= 10;
-    } while (temp > 0);
-
-    for (int i = n - 1; i >= 0; i--) {
-        char c[2] = {num_str[i], 0};
-        serial_puts(c);
+    serial_puts("Total Sectors: ");
+    serial_putdec64(ide_total_sectors);
+    serial_puts(ide_lba48 ? " (LBA48)\n" : " (LBA28)\n");
+
+    // 字 47 低字节：READ/WRITE MULTIPLE 每块最大扇区数
+    ide_set_multiple(buffer[47] & 0xFF);
+    if (ide_multiple) {
+        serial_puts("IDE multiple mode: ");
+        serial_putdec64(ide_multiple);
+        serial_puts(" sectors per block\n");
     }
-    serial_puts("\n");
+}
+
+uint64_t ide_get_total_sectors(void) {
+    return ide_total_sectors;
 }
@@ -0,0 +1,106 @@
+#include "drivers/pci.h"
+#include "io.h"
+
+static uint32_t pci_address(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset) {
+    return (1U << 31) |
+           ((uint32_t)bus << 16) |
+           ((uint32_t)(dev & 0x1F) << 11) |
+           ((uint32_t)(func & 0x07) << 8) |
+           (offset & 0xFC);
+}
+
+uint32_t pci_config_read32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, dev, func, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_config_read16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset) {
+    uint32_t value = pci_config_read32(bus, dev, func, offset);
+    return (uint16_t)(value >> ((offset & 2) * 8));
+}
+
+uint8_t pci_config_read8(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset) {
+    uint32_t value = pci_config_read32(bus, dev, func, offset);
+    return (uint8_t)(value >> ((offset & 3) * 8));
+}
+
+void pci_config_write32(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, dev, func, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+// 直接写 16 位，不做 32 位读-改-写：COMMAND 的另一半是写 1 清零的 STATUS，
+// 写回读到的值会顺带清掉挂起的错误位
+void pci_config_write16(uint8_t bus, uint8_t dev, uint8_t func, uint8_t offset, uint16_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, dev, func, offset));
+    outw(PCI_CONFIG_DATA + (offset & 2), value);
+}
+
+static void pci_fill_device(uint8_t bus, uint8_t dev, uint8_t func, pci_device_t* out) {
+    out->bus = bus;
+    out->device = dev;
+    out->function = func;
+    out->vendor_id = pci_config_read16(bus, dev, func, PCI_VENDOR_ID);
+    out->device_id = pci_config_read16(bus, dev, func, PCI_DEVICE_ID);
+    out->class_code = pci_config_read8(bus, dev, func, PCI_CLASS);
+    out->subclass = pci_config_read8(bus, dev, func, PCI_SUBCLASS);
+    out->prog_if = pci_config_read8(bus, dev, func, PCI_PROG_IF);
+}
+
+// 暴力枚举所有总线/设备/功能，match 返回 true 时停止
+static bool pci_scan(bool (*match)(const pci_device_t*, const void*), const void* ctx, pci_device_t* out) {
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t dev = 0; dev < 32; dev++) {
+            for (uint8_t func = 0; func < 8; func++) {
+                uint16_t vendor = pci_config_read16(bus, dev, func, PCI_VENDOR_ID);
+                if (vendor == 0xFFFF) {
+                    if (func == 0) break;
+                    continue;
+                }
+
+                pci_device_t pdev;
+                pci_fill_device(bus, dev, func, &pdev);
+                if (match(&pdev, ctx)) {
+                    *out = pdev;
+                    return true;
+                }
+
+                // 非多功能设备只有功能 0
+                if (func == 0 && !(pci_config_read8(bus, dev, 0, PCI_HEADER_TYPE) & 0x80)) {
+                    break;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+static bool match_class(const pci_device_t* pdev, const void* ctx) {
+    const uint8_t* want = (const uint8_t*)ctx;
+    return pdev->class_code == want[0] && pdev->subclass == want[1];
+}
+
+static bool match_id(const pci_device_t* pdev, const void* ctx) {
+    const uint16_t* want = (const uint16_t*)ctx;
+    return pdev->vendor_id == want[0] && pdev->device_id == want[1];
+}
+
+bool pci_find_class(uint8_t class_code, uint8_t subclass, pci_device_t* out) {
+    uint8_t want[2] = {class_code, subclass};
+    return pci_scan(match_class, want, out);
+}
+
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t* out) {
+    uint16_t want[2] = {vendor_id, device_id};
+    return pci_scan(match_id, want, out);
+}
+
+uint32_t pci_read_bar(const pci_device_t* pdev, int bar) {
+    return pci_config_read32(pdev->bus, pdev->device, pdev->function, PCI_BAR0 + bar * 4);
+}
+
+void pci_enable_bus_master(const pci_device_t* pdev) {
+    uint16_t cmd = pci_config_read16(pdev->bus, pdev->device, pdev->function, PCI_COMMAND);
+    cmd |= PCI_CMD_BUS_MASTER | PCI_CMD_IO_SPACE | PCI_CMD_MEM_SPACE;
+    pci_config_write16(pdev->bus, pdev->device, pdev->function, PCI_COMMAND, cmd);
+}
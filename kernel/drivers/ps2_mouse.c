@@ -1,5 +1,6 @@
 #include "drivers/ps2_mouse.h"
 #include "io.h"
+#include "drivers/pic.h"
 #include "serial.h"
 #include "cstd.h"
 #include "graphics.h"
@@ -100,10 +101,10 @@ void mouse_init(void) {
     mouse_write(0xF4); // Enable
     mouse_read();      // ACK
 
-    // 0xF9 = 11111001 (开启 IRQ1 键盘 和 IRQ2 级联口)
-    outb(0x21, 0xF9); 
-    // 0xEF = 11101111 (开启 IRQ12 鼠标)
-    outb(0xA1, 0xEF);
+    // 开启 IRQ1 键盘、IRQ2 级联口和 IRQ12 鼠标，不改动其他驱动已开启的 IRQ (如 IRQ14 磁盘)
+    pic_enable_irq(1);
+    pic_enable_irq(2);
+    pic_enable_irq(12);
 
     register_interrupt_handler(44, mouse_handler);
     
@@ -0,0 +1,371 @@
+#include "drivers/virtio_blk.h"
+#include "drivers/pci.h"
+#include "drivers/pic.h"
+#include "serial.h"
+#include "string.h"
+#include "io.h"
+#include "idt.h"
+#include "timer.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "cpu.h"
+
+// split virtqueue 结构 (legacy 布局：描述符表 + 可用环，已用环按页对齐)
+typedef struct __attribute__((packed)) {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} virtq_desc_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t flags;
+    volatile uint16_t idx;
+    uint16_t ring[];
+} virtq_avail_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t id;
+    uint32_t len;
+} virtq_used_elem_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t flags;
+    volatile uint16_t idx;
+    virtq_used_elem_t ring[];
+} virtq_used_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} virtio_blk_req_hdr_t;
+
+// 请求槽 i 固定使用描述符 3i (头)、3i+1 (数据)、3i+2 (状态)
+typedef struct {
+    virtio_blk_req_hdr_t hdr;
+    volatile uint8_t status;
+    bool in_use;
+    virtio_blk_done_t done;
+    void* ctx;
+} virtio_blk_slot_t;
+
+static uint16_t io_base = 0;
+static uint16_t queue_size = 0;
+static uint32_t max_reqs = 0;
+static virtq_desc_t* desc = NULL;
+static virtq_avail_t* avail = NULL;
+static virtq_used_t* used = NULL;
+static uint16_t last_used_idx = 0;
+static uint16_t pending_kick = 0;
+static virtio_blk_slot_t* slots = NULL;
+static uint8_t* queue_mem = NULL;
+static uint32_t queue_pages = 0;
+static bool virtio_ready = false;
+
+static inline void virtio_mb(void) {
+    asm volatile("mfence" : : : "memory");
+}
+
+static int virtio_alloc_slot(void) {
+    for (uint32_t i = 0; i < max_reqs; i++) {
+        if (!slots[i].in_use) {
+            slots[i].in_use = true;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// 回收已用环中完成的请求并调用回调，调用者需关中断
+static void virtio_reap_locked(void) {
+    while (last_used_idx != used->idx) {
+        virtio_mb();
+        virtq_used_elem_t* e = &used->ring[last_used_idx % queue_size];
+        uint32_t slot = e->id / 3;
+        last_used_idx++;
+
+        if (slot >= max_reqs || !slots[slot].in_use) continue;
+
+        virtio_blk_slot_t* s = &slots[slot];
+        int status = s->status == VIRTIO_BLK_S_OK ? 0 : -1;
+        virtio_blk_done_t done = s->done;
+        void* ctx = s->ctx;
+
+        s->in_use = false;
+        if (done) done(ctx, status);
+    }
+}
+
+void virtio_blk_poll(void) {
+    if (!virtio_ready) return;
+
+    uint64_t flags = cpu_irq_save();
+    virtio_reap_locked();
+    cpu_irq_restore(flags);
+}
+
+static void virtio_irq_handler(interrupt_frame_t* frame) {
+    // 读 ISR 寄存器即应答中断
+    uint8_t isr = inb(io_base + VIRTIO_PCI_ISR);
+    if (isr & 1) {
+        virtio_reap_locked();
+    }
+}
+
+int virtio_blk_queue(uint64_t lba, uint32_t num_sectors, void* buffer, bool write,
+                     virtio_blk_done_t done, void* ctx) {
+    if (!virtio_ready) return -1;
+
+    // 每个请求只有一个数据描述符，物理不连续的缓冲区直接报错 (块设备层会先中转)
+    uint64_t data_addr = vmm_dma_addr(buffer, (uint64_t)num_sectors * 512);
+    if (data_addr == 0) {
+        serial_puts("virtio-blk: buffer is not physically contiguous\n");
+        if (done) done(ctx, -1);
+        return 0;
+    }
+
+    uint64_t flags = cpu_irq_save();
+
+    int slot = virtio_alloc_slot();
+    if (slot < 0) {
+        cpu_irq_restore(flags);
+        return -1;
+    }
+
+    virtio_blk_slot_t* s = &slots[slot];
+    s->hdr.type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    s->hdr.reserved = 0;
+    s->hdr.sector = lba;
+    s->status = 0xFF;
+    s->done = done;
+    s->ctx = ctx;
+
+    uint16_t head = (uint16_t)(slot * 3);
+    virtq_desc_t* d = &desc[head];
+
+    d[0].addr = virt_to_phys(&s->hdr);
+    d[0].len = sizeof(virtio_blk_req_hdr_t);
+    d[0].flags = VIRTQ_DESC_F_NEXT;
+    d[0].next = head + 1;
+
+    d[1].addr = data_addr;
+    d[1].len = num_sectors * 512;
+    d[1].flags = VIRTQ_DESC_F_NEXT | (write ? 0 : VIRTQ_DESC_F_WRITE);
+    d[1].next = head + 2;
+
+    d[2].addr = virt_to_phys(&s->status);
+    d[2].len = 1;
+    d[2].flags = VIRTQ_DESC_F_WRITE;
+    d[2].next = 0;
+
+    avail->ring[avail->idx % queue_size] = head;
+    virtio_mb();
+    avail->idx++;
+    pending_kick++;
+
+    cpu_irq_restore(flags);
+    return 0;
+}
+
+void virtio_blk_kick(void) {
+    if (!virtio_ready || pending_kick == 0) return;
+
+    virtio_mb();
+    pending_kick = 0;
+    outw(io_base + VIRTIO_PCI_QUEUE_NOTIFY, 0);
+}
+
+bool virtio_blk_present(void) {
+    return virtio_ready;
+}
+
+typedef struct {
+    volatile int remaining;
+    volatile int status;
+} virtio_sync_ctx_t;
+
+static void virtio_sync_done(void* ctx, int status) {
+    virtio_sync_ctx_t* sync = (virtio_sync_ctx_t*)ctx;
+    if (status != 0) sync->status = status;
+    sync->remaining--;
+}
+
+// 等待完成：开中断时 hlt 等待设备中断，否则轮询已用环
+static int virtio_wait(virtio_sync_ctx_t* sync) {
+    uint64_t rflags;
+    asm volatile("pushfq; pop %0" : "=r"(rflags));
+    bool can_halt = (rflags & 0x200) != 0;
+
+    uint64_t deadline = timer_get_ticks() + 5000;
+    uint32_t spins = 10000000;
+
+    while (sync->remaining > 0) {
+        virtio_blk_poll();
+        if (sync->remaining <= 0) break;
+
+        if (can_halt) {
+            if (timer_get_ticks() > deadline) return -1;
+            // 关中断后再查一次，完成中断落在检查与 hlt 之间时不会错过唤醒
+            asm volatile("cli" : : : "memory");
+            if (sync->remaining <= 0) {
+                asm volatile("sti" : : : "memory");
+                break;
+            }
+            asm volatile("sti; hlt" : : : "memory");
+        } else if (--spins == 0) {
+            return -1;
+        }
+    }
+
+    return sync->status;
+}
+
+static int virtio_blk_transfer(uint64_t lba, uint32_t num_sectors, void* buffer, bool write) {
+    if (!virtio_ready || num_sectors == 0) return -1;
+
+    virtio_sync_ctx_t sync = {1, 0};
+    if (virtio_blk_queue(lba, num_sectors, buffer, write, virtio_sync_done, &sync) != 0) {
+        return -1;
+    }
+    virtio_blk_kick();
+
+    int result = virtio_wait(&sync);
+    if (sync.remaining > 0) {
+        // 超时：sync 在栈上，复位设备保证返回后不再有完成回调写入
+        virtio_blk_reset();
+    }
+
+    if (result != 0) {
+        serial_puts("virtio-blk: request failed at LBA ");
+        serial_putdec64(lba);
+        serial_puts("\n");
+        return -1;
+    }
+    return 0;
+}
+
+int virtio_blk_read_sectors(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    return virtio_blk_transfer(lba, num_sectors, buffer, false);
+}
+
+int virtio_blk_write_sectors(uint64_t lba, uint32_t num_sectors, void* buffer) {
+    return virtio_blk_transfer(lba, num_sectors, buffer, true);
+}
+
+// 复位后重新协商 (不需要任何可选特性)
+static void virtio_handshake(void) {
+    outb(io_base + VIRTIO_PCI_STATUS, 0);
+    outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    inl(io_base + VIRTIO_PCI_HOST_FEATURES);
+    outl(io_base + VIRTIO_PCI_GUEST_FEATURES, 0);
+}
+
+void virtio_blk_reset(void) {
+    if (!virtio_ready) return;
+
+    uint64_t flags = cpu_irq_save();
+
+    // 写 0 复位后设备不再访问队列内存和数据缓冲区
+    outb(io_base + VIRTIO_PCI_STATUS, 0);
+
+    for (uint32_t i = 0; i < max_reqs; i++) {
+        virtio_blk_slot_t* s = &slots[i];
+        if (!s->in_use) continue;
+
+        s->in_use = false;
+        if (s->done) s->done(s->ctx, -1);
+    }
+
+    memset(queue_mem, 0, queue_pages * 4096);
+    last_used_idx = 0;
+    pending_kick = 0;
+
+    virtio_handshake();
+    outw(io_base + VIRTIO_PCI_QUEUE_SEL, 0);
+    outl(io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)(virt_to_phys(queue_mem) >> 12));
+    outb(io_base + VIRTIO_PCI_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+    cpu_irq_restore(flags);
+    serial_puts("virtio-blk: device reset\n");
+}
+
+int virtio_blk_init(void) {
+    pci_device_t pdev;
+    if (!pci_find_device(VIRTIO_PCI_VENDOR, VIRTIO_PCI_DEVICE_BLK, &pdev)) {
+        return -1;
+    }
+
+    serial_puts("Initializing virtio-blk device...\n");
+
+    uint32_t bar0 = pci_read_bar(&pdev, 0);
+    if (!(bar0 & 1)) {
+        serial_puts("virtio-blk: BAR0 is not I/O space\n");
+        return -1;
+    }
+    io_base = bar0 & 0xFFFC;
+    pci_enable_bus_master(&pdev);
+
+    virtio_handshake();
+
+    outw(io_base + VIRTIO_PCI_QUEUE_SEL, 0);
+    queue_size = inw(io_base + VIRTIO_PCI_QUEUE_SIZE);
+    if (queue_size == 0) {
+        serial_puts("virtio-blk: queue 0 unavailable\n");
+        outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    uint32_t desc_bytes = 16 * queue_size;
+    uint32_t avail_bytes = 6 + 2 * queue_size;
+    uint32_t used_offset = (desc_bytes + avail_bytes + 4095) & ~4095U;
+    uint32_t used_bytes = 6 + 8 * queue_size;
+    queue_pages = (used_offset + used_bytes + 4095) / 4096;
+
+    queue_mem = (uint8_t*)pmm_alloc_blocks(queue_pages);
+    slots = (virtio_blk_slot_t*)pmm_alloc_zpage();
+    if (queue_mem == NULL || slots == NULL) {
+        serial_puts("virtio-blk: out of memory\n");
+        outb(io_base + VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+    memset(queue_mem, 0, queue_pages * 4096);
+
+    desc = (virtq_desc_t*)queue_mem;
+    avail = (virtq_avail_t*)(queue_mem + desc_bytes);
+    used = (virtq_used_t*)(queue_mem + used_offset);
+    last_used_idx = 0;
+    pending_kick = 0;
+
+    max_reqs = queue_size / 3;
+    if (max_reqs > VIRTIO_BLK_MAX_REQS) max_reqs = VIRTIO_BLK_MAX_REQS;
+    if (max_reqs * sizeof(virtio_blk_slot_t) > 4096) max_reqs = 4096 / sizeof(virtio_blk_slot_t);
+
+    outl(io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)(virt_to_phys(queue_mem) >> 12));
+
+    uint8_t irq = pci_config_read8(pdev.bus, pdev.device, pdev.function, PCI_INTERRUPT_LINE);
+    if (irq < 16) {
+        register_interrupt_handler(32 + irq, virtio_irq_handler);
+        pic_enable_irq(irq);
+        if (irq >= 8) pic_enable_irq(2);
+    }
+
+    outb(io_base + VIRTIO_PCI_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+    virtio_ready = true;
+
+    uint32_t capacity_lo = inl(io_base + VIRTIO_PCI_CONFIG);
+    serial_puts("virtio-blk: queue size ");
+    serial_putdec64(queue_size);
+    serial_puts(", IRQ ");
+    serial_putdec64(irq);
+    serial_puts(", capacity ");
+    serial_putdec64(capacity_lo);
+    serial_puts(" sectors\n");
+
+    return 0;
+}
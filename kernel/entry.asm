@@ -0,0 +1,73 @@
+[bits 64]
+; 内核入口：引导程序在固件页表 (恒等映射) 下跳转到物理地址 0x100000，
+; 这里先建立高半区映射，再跳到链接在高半区的 kmain
+
+KERNEL_VMA equ 0xFFFFFFFF80000000
+
+extern kmain
+global _start
+
+section .text.entry
+_start:
+    mov r8, rcx                 ; 启动参数 (ms_abi 第一个参数)
+
+    ; 复制固件页表低半部分，保留恒等映射
+    mov rsi, cr3
+    and rsi, ~0xFFF
+    lea rdi, [rel boot_pml4]
+    mov rcx, 256
+    cld
+    rep movsq
+
+    ; PML4[511] -> boot_pdpt，PDPT[510] -> boot_pd，即 KERNEL_VMA 起的 1GB
+    lea rax, [rel boot_pdpt]
+    or rax, 0x3
+    lea rdi, [rel boot_pml4]
+    mov [rdi + 511 * 8], rax
+
+    lea rax, [rel boot_pd]
+    or rax, 0x3
+    lea rdi, [rel boot_pdpt]
+    mov [rdi + 510 * 8], rax
+
+    ; 512 个 2MB 大页映射物理 0 - 1GB (Present | Writable | PS)
+    lea rdi, [rel boot_pd]
+    mov rax, 0x83
+    mov rcx, 512
+.fill_pd:
+    mov [rdi], rax
+    add rax, 0x200000
+    add rdi, 8
+    loop .fill_pd
+
+    lea rax, [rel boot_pml4]
+    mov cr3, rax
+
+    ; 切换到内核自己的栈。固件栈位于 BootServicesData 中，
+    ; PMM 会把这类内存当作空闲页回收
+    mov rsp, boot_stack_top
+    xor rbp, rbp
+    sub rsp, 32                 ; ms_abi 影子空间
+
+    mov rcx, r8
+    mov rax, kmain
+    call rax
+
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; 启动页表放在 .data 中随内核文件加载 (BSS 不会被清零)
+section .data.boot_tables progbits alloc write noexec align=4096
+boot_pml4:  times 4096 db 0
+boot_pdpt:  times 4096 db 0
+boot_pd:    times 4096 db 0
+
+; 内核启动栈，位于高半区内核映像内 (前 16MB 由 PMM 保留)
+KERNEL_STACK_SIZE equ 0x10000
+
+section .bss
+align 16
+boot_stack:     resb KERNEL_STACK_SIZE
+boot_stack_top:
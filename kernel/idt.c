@@ -51,48 +51,53 @@ void idt_handler(interrupt_frame_t *frame) {
     } else {
         // 发生未处理的中断/异常
         if (frame->int_no < 32) {
-            serial_puts("\n================ EXCEPTION DUMP ================\n");
-            serial_puts("EXCEPTION: ");
-            serial_putdec64(frame->int_no);
-
-            if (frame->int_no == 14) {
-                uint64_t cr2;
-                asm volatile("mov %%cr2, %0" : "=r"(cr2));
-                serial_puts(" (PAGE FAULT)");
-                serial_puts("\nFaulting Address (CR2): 0x");
-                serial_puthex64(cr2);
-            }
-            
-            serial_puts("\nError Code: ");
-            serial_puthex64(frame->error_code);
-            serial_puts("\n\n--- General Purpose Registers ---\n");
-
-            // 打印通用寄存器 (取决于你的 interrupt_frame_t 成员定义)
-            print_reg("RAX", frame->rax); print_reg("RBX", frame->rbx); print_reg("RCX", frame->rcx); 
-            serial_puts("\n");
-            print_reg("RDX", frame->rdx); print_reg("RSI", frame->rsi); print_reg("RDI", frame->rdi);
-            serial_puts("\n");
-            print_reg("RBP", frame->rbp); print_reg("R8 ", frame->r8);  print_reg("R9 ", frame->r9);
-            serial_puts("\n");
-            print_reg("R10", frame->r10); print_reg("R11", frame->r11); print_reg("R12", frame->r12);
-            serial_puts("\n");
-            print_reg("R13", frame->r13); print_reg("R14", frame->r14); print_reg("R15", frame->r15);
-            
-            serial_puts("\n\n--- CPU State ---\n");
-            print_reg("RIP", frame->rip);    print_reg("CS ", frame->cs);
-            serial_puts("\n");
-            print_reg("RFLAGS", frame->rflags); print_reg("RSP", frame->rsp); print_reg("SS ", frame->ss);
-            
-            serial_puts("\n================================================\n");
-            
-            // 异常发生后，通常内核无法继续运行，进入死循环
-            while(1) { asm("hlt"); }
+            idt_dump_exception(frame);
         }
     }
 
     send_eoi(frame->int_no);
 }
 
+// 打印异常现场并停机，供无法恢复的异常处理程序调用
+void idt_dump_exception(interrupt_frame_t *frame) {
+    serial_puts("\n================ EXCEPTION DUMP ================\n");
+    serial_puts("EXCEPTION: ");
+    serial_putdec64(frame->int_no);
+
+    if (frame->int_no == 14) {
+        uint64_t cr2;
+        asm volatile("mov %%cr2, %0" : "=r"(cr2));
+        serial_puts(" (PAGE FAULT)");
+        serial_puts("\nFaulting Address (CR2): 0x");
+        serial_puthex64(cr2);
+    }
+    
+    serial_puts("\nError Code: ");
+    serial_puthex64(frame->error_code);
+    serial_puts("\n\n--- General Purpose Registers ---\n");
+
+    // 打印通用寄存器 (取决于你的 interrupt_frame_t 成员定义)
+    print_reg("RAX", frame->rax); print_reg("RBX", frame->rbx); print_reg("RCX", frame->rcx); 
+    serial_puts("\n");
+    print_reg("RDX", frame->rdx); print_reg("RSI", frame->rsi); print_reg("RDI", frame->rdi);
+    serial_puts("\n");
+    print_reg("RBP", frame->rbp); print_reg("R8 ", frame->r8);  print_reg("R9 ", frame->r9);
+    serial_puts("\n");
+    print_reg("R10", frame->r10); print_reg("R11", frame->r11); print_reg("R12", frame->r12);
+    serial_puts("\n");
+    print_reg("R13", frame->r13); print_reg("R14", frame->r14); print_reg("R15", frame->r15);
+    
+    serial_puts("\n\n--- CPU State ---\n");
+    print_reg("RIP", frame->rip);    print_reg("CS ", frame->cs);
+    serial_puts("\n");
+    print_reg("RFLAGS", frame->rflags); print_reg("RSP", frame->rsp); print_reg("SS ", frame->ss);
+    
+    serial_puts("\n================================================\n");
+    
+    // 异常发生后，通常内核无法继续运行，进入死循环
+    while(1) { asm("hlt"); }
+}
+
 // 发送EOI信号
 void send_eoi(int int_no) {
     // 只有硬件中断 (32-47) 需要发送 EOI
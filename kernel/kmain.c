@@ -47,6 +47,11 @@
 #include "graphics.h"
 #include "shell.h"
 #include "drivers/fs/fat32.h"
+#include "drivers/bcache.h"
+#include "drivers/fs/pcache.h"
+#include "drivers/disk.h"
+#include "memory.h"
+#include "acpi.h"
 #include "string.h"
 
 // 终端窗口配置
@@ -129,11 +134,17 @@ void kmain(void *params) {
     serial_puthex64(kernel_params.descriptor_size);
     serial_puts("\n");
     
+    acpi_init(kernel_params.acpi_rsdp);
     pmm_init((void *)kernel_params.memory_map_addr, 
              kernel_params.memory_map_size, 
              kernel_params.descriptor_size);
+    vmm_init();
+    mem_init();
     //serial_puts("a\n")   ;      
     ide_init();
+    disk_init();
+    bcache_init();
+    pcache_init();
     keyboard_init();
     mouse_init();
     
@@ -165,10 +176,12 @@ void kmain(void *params) {
     // 图形系统
     graphics_init(&kernel_params);
     
-    // 开启主片: IRQ0(时钟), IRQ1(键盘), IRQ2(级联)
-    outb(0x21, 0xF8);
-    // 开启从片: IRQ12(鼠标)
-    outb(0xA1, 0xEF);
+    // 开启 IRQ0(时钟), IRQ1(键盘), IRQ2(级联), IRQ12(鼠标)。
+    // 只清除这些屏蔽位，驱动已开启的 IRQ (IRQ14 磁盘、virtio 的 PCI IRQ) 保持开启
+    pic_enable_irq(0);
+    pic_enable_irq(1);
+    pic_enable_irq(2);
+    pic_enable_irq(12);
     asm volatile("sti");
     //serial_puts("a");
 
@@ -180,9 +193,11 @@ void kmain(void *params) {
     term_puts("\n");
     term_puts("Root@MWOS: /# ");
 
-    // 主循环
+    // 主循环：空闲时先补充预清零页池，池满后再休眠
     while (1) {
-        asm volatile("hlt");
+        if (pmm_zero_pool_refill(PMM_ZERO_REFILL_BATCH) == 0) {
+            asm volatile("hlt");
+        }
     }
 }
 
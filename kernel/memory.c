@@ -23,31 +23,409 @@
 
 #include "memory.h"
 #include "serial.h"
+#include "pmm.h"
+#include "cpu.h"
+#include "timer.h"
+#include "vmm.h"
 
-// 我们将堆放在32MB处（0x2000000），远离内核代码和数据
-#define HEAP_BASE_ADDR 0x2000000
-#define HEAP_SIZE (32 * 1024 * 1024)
-
-static uint32_t heap_used = 0;
+// 每个 slab 占一页，页首为 slab 头，对象从 SLAB_HEADER_SIZE 开始排列。
+// kfree 通过把指针向下对齐到页边界找到所属 slab。
+typedef struct slab {
+    uint32_t magic;
+    uint16_t class_idx;     // SLAB_LARGE 表示按页分配的大对象
+    uint16_t in_use;        // 已分配对象数
+    uint32_t pages;         // 大对象占用的页数
+    uint32_t size;          // 大对象的请求大小
+    void* free_list;        // 空闲对象单链表
+    struct slab* prev;      // 所在尺寸类的部分空闲链表
+    struct slab* next;
+} slab_t;
 
-typedef struct alloc_info {
+typedef struct {
     uint32_t size;
-    uint32_t magic;
-} alloc_info_t;
+    uint32_t objs_per_slab;
+    slab_t* partial;        // 还有空闲对象的 slab
+    uint32_t empty;         // partial 中完全空闲的 slab 数
+    uint32_t slabs;         // 占用页数
+    uint32_t out;           // 从 slab 中取出的对象数 (含弹匣中缓存的)
+} size_class_t;
+
+// 每 CPU 弹匣：常用小对象在本地数组中分配/释放，不触碰全局锁；
+// 空了从 slab 层批量补充，满了批量归还一半
+typedef struct {
+    uint32_t count;
+    void* objs[MEM_MAG_SIZE];
+} mem_magazine_t;
+
+typedef struct {
+    mem_magazine_t mags[MEM_CLASS_COUNT];
+    uint32_t allocs[MEM_CLASS_COUNT + 1];   // 最后一项为大对象
+    uint32_t frees[MEM_CLASS_COUNT + 1];
+} __attribute__((aligned(64))) mem_cpu_cache_t;
+
+#define SLAB_MAGIC          0x51AB51AB
+#define SLAB_LARGE          0xFFFF
+#define SLAB_HEADER_SIZE    64
+#define SLAB_MAX_EMPTY      1       // 每个尺寸类保留的空 slab 数，避免反复申请/归还页
+#define HEAP_RELEASE_BATCH  64      // 释放按需区间时每批取消映射的页数
+
+static const uint32_t class_sizes[MEM_CLASS_COUNT] = {16, 32, 64, 128, 256, 512, 1024};
+
+static size_class_t classes[MEM_CLASS_COUNT];
+static uint32_t large_pages;
+static uint32_t large_in_use;
+static spinlock_t heap_lock;
+static mem_cpu_cache_t cpu_caches[MAX_CPUS];
+static bool heap_ready = false;
+
+// 按需分页堆：大对象只在 KERNEL_HEAP_BASE 区间内保留虚拟地址，
+// 首次访问时由缺页处理程序分配物理页，不要求物理连续
+typedef struct {
+    uint64_t start;
+    uint64_t pages;
+} heap_extent_t;
 
-#define ALLOC_MAGIC 0xDEADBEEF
+static heap_extent_t va_free[MEM_HEAP_EXTENTS];     // 按地址排序的空闲虚拟区间
+static uint32_t va_free_count;
+static bool demand_heap;
+static uint64_t demand_pages;                       // 已保留的虚拟页数
+
+static bool heap_va_reserved(uint64_t addr);
+
+// 分配跟踪环：无锁、定长二进制记录，默认关闭
+static mem_trace_rec_t trace_ring[MEM_TRACE_ENTRIES];
+static volatile uint64_t trace_head;
+static volatile bool trace_enabled;
 
 void mem_init(void) {
-    heap_used = 0;
-    serial_puts("Memory manager initialized at 0x");
-    serial_puthex64(HEAP_BASE_ADDR);
-    serial_puts(" (");
-    serial_putdec32(HEAP_SIZE / 1024 / 1024);
-    serial_puts(" MB heap)\n");
+    for (int i = 0; i < MEM_CLASS_COUNT; i++) {
+        classes[i].size = class_sizes[i];
+        classes[i].objs_per_slab = (4096 - SLAB_HEADER_SIZE) / class_sizes[i];
+        classes[i].partial = NULL;
+        classes[i].empty = 0;
+        classes[i].slabs = 0;
+        classes[i].out = 0;
+    }
+    large_pages = 0;
+    large_in_use = 0;
+    heap_lock = (spinlock_t)SPINLOCK_INIT;
+
+    for (int c = 0; c < MAX_CPUS; c++) {
+        for (int i = 0; i < MEM_CLASS_COUNT; i++) {
+            cpu_caches[c].mags[i].count = 0;
+        }
+        for (int i = 0; i <= MEM_CLASS_COUNT; i++) {
+            cpu_caches[c].allocs[i] = 0;
+            cpu_caches[c].frees[i] = 0;
+        }
+    }
+    mem_trace_clear();
+    trace_enabled = false;
+
+    va_free[0].start = KERNEL_HEAP_BASE;
+    va_free[0].pages = KERNEL_HEAP_SIZE / 4096;
+    va_free_count = 1;
+    demand_pages = 0;
+    demand_heap = vmm_add_demand_region(KERNEL_HEAP_BASE, KERNEL_HEAP_SIZE, heap_va_reserved) == 0;
+    heap_ready = true;
+
+    serial_puts("Memory manager initialized (slab allocator, ");
+    serial_putdec32(MEM_CLASS_COUNT);
+    serial_puts(" size classes up to ");
+    serial_putdec32(MEM_MAX_SMALL_SIZE);
+    serial_puts(" bytes, ");
+    serial_putdec32(MEM_MAG_SIZE);
+    serial_puts("-entry per-CPU magazines)\n");
+}
+
+// 通过原子递增占位，写完记录后再发布序号，读者据此丢弃写了一半的记录
+static void mem_trace_record(uint32_t op, uint64_t caller, void* ptr, uint32_t size) {
+    uint64_t seq = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    mem_trace_rec_t* rec = &trace_ring[seq & (MEM_TRACE_ENTRIES - 1)];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    rec->tick = timer_get_ticks();
+    rec->caller = caller;
+    rec->ptr = (uint64_t)ptr;
+    rec->size = size;
+    rec->op = op;
+    rec->cpu = (uint16_t)cpu_current_id();
+    __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+void mem_trace_enable(bool enable) {
+    trace_enabled = enable;
+}
+
+bool mem_trace_is_enabled(void) {
+    return trace_enabled;
+}
+
+void mem_trace_clear(void) {
+    for (int i = 0; i < MEM_TRACE_ENTRIES; i++) {
+        trace_ring[i].seq = 0;
+    }
+    trace_head = 0;
+}
+
+// 按时间顺序复制最近的最多 max 条记录
+uint32_t mem_trace_snapshot(mem_trace_rec_t* out, uint32_t max) {
+    uint64_t head = __atomic_load_n(&trace_head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > MEM_TRACE_ENTRIES ? head - MEM_TRACE_ENTRIES : 0;
+    if (head - first > max) first = head - max;
+
+    uint32_t n = 0;
+    for (uint64_t seq = first; seq < head; seq++) {
+        mem_trace_rec_t* rec = &trace_ring[seq & (MEM_TRACE_ENTRIES - 1)];
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq + 1) continue;
+
+        out[n] = *rec;
+        // 复制期间被覆盖则丢弃
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq + 1) continue;
+        n++;
+    }
+    return n;
+}
+
+static inline int size_to_class(uint32_t size) {
+    // 最小尺寸类为 16 字节：class = ceil(log2(size)) - 4
+    if (size <= 16) return 0;
+    return 32 - __builtin_clz(size - 1) - 4;
+}
+
+static inline slab_t* ptr_to_slab(void* ptr) {
+    return (slab_t*)((uint64_t)ptr & ~0xFFFULL);
+}
+
+static void partial_push(size_class_t* cls, slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = cls->partial;
+    if (cls->partial) cls->partial->prev = slab;
+    cls->partial = slab;
 }
 
-static uint8_t* get_heap_base(void) {
-    return (uint8_t*)HEAP_BASE_ADDR;
+static void partial_remove(size_class_t* cls, slab_t* slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else cls->partial = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    slab->prev = NULL;
+    slab->next = NULL;
+}
+
+static slab_t* slab_create(int class_idx) {
+    size_class_t* cls = &classes[class_idx];
+    slab_t* slab = (slab_t*)pmm_alloc_page();
+    if (!slab) return NULL;
+
+    slab->magic = SLAB_MAGIC;
+    slab->class_idx = (uint16_t)class_idx;
+    slab->in_use = 0;
+    slab->pages = 1;
+    slab->size = cls->size;
+    slab->prev = NULL;
+    slab->next = NULL;
+
+    // 把页内对象串成空闲链表
+    uint8_t* obj = (uint8_t*)slab + SLAB_HEADER_SIZE;
+    slab->free_list = obj;
+    for (uint32_t i = 0; i + 1 < cls->objs_per_slab; i++) {
+        *(void**)obj = obj + cls->size;
+        obj += cls->size;
+    }
+    *(void**)obj = NULL;
+
+    cls->slabs++;
+    cls->empty++;
+    partial_push(cls, slab);
+    return slab;
+}
+
+// slab 层分配/释放，调用者持有 heap_lock
+static void* slab_alloc_obj(int class_idx) {
+    size_class_t* cls = &classes[class_idx];
+
+    slab_t* slab = cls->partial;
+    if (!slab) slab = slab_create(class_idx);
+    if (!slab) return NULL;
+
+    if (slab->in_use == 0) cls->empty--;
+
+    void* ptr = slab->free_list;
+    slab->free_list = *(void**)ptr;
+    slab->in_use++;
+    if (!slab->free_list) partial_remove(cls, slab);
+
+    cls->out++;
+    return ptr;
+}
+
+static void slab_free_obj(int class_idx, void* ptr) {
+    size_class_t* cls = &classes[class_idx];
+    slab_t* slab = ptr_to_slab(ptr);
+
+    bool was_full = slab->free_list == NULL;
+    *(void**)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->in_use--;
+    cls->out--;
+
+    if (was_full) partial_push(cls, slab);
+
+    if (slab->in_use == 0) {
+        // 空 slab 超过保留数量时归还给 PMM
+        if (cls->empty >= SLAB_MAX_EMPTY) {
+            partial_remove(cls, slab);
+            slab->magic = 0;
+            cls->slabs--;
+            pmm_free_page(slab);
+        } else {
+            cls->empty++;
+        }
+    }
+}
+
+// 首次适配分配一段虚拟地址，调用者持有 heap_lock
+static uint64_t heap_va_alloc(uint64_t pages) {
+    for (uint32_t i = 0; i < va_free_count; i++) {
+        if (va_free[i].pages < pages) continue;
+
+        uint64_t va = va_free[i].start;
+        va_free[i].start += pages * 4096;
+        va_free[i].pages -= pages;
+        if (va_free[i].pages == 0) {
+            for (uint32_t j = i; j + 1 < va_free_count; j++) va_free[j] = va_free[j + 1];
+            va_free_count--;
+        }
+        return va;
+    }
+    return 0;
+}
+
+// 归还虚拟地址并与相邻空闲区间合并，调用者持有 heap_lock
+static void heap_va_free(uint64_t va, uint64_t pages) {
+    uint32_t i = 0;
+    while (i < va_free_count && va_free[i].start < va) i++;
+
+    bool merge_prev = i > 0 && va_free[i - 1].start + va_free[i - 1].pages * 4096 == va;
+    bool merge_next = i < va_free_count && va + pages * 4096 == va_free[i].start;
+
+    if (merge_prev && merge_next) {
+        va_free[i - 1].pages += pages + va_free[i].pages;
+        for (uint32_t j = i; j + 1 < va_free_count; j++) va_free[j] = va_free[j + 1];
+        va_free_count--;
+    } else if (merge_prev) {
+        va_free[i - 1].pages += pages;
+    } else if (merge_next) {
+        va_free[i].start = va;
+        va_free[i].pages += pages;
+    } else if (va_free_count < MEM_HEAP_EXTENTS) {
+        for (uint32_t j = va_free_count; j > i; j--) va_free[j] = va_free[j - 1];
+        va_free[i].start = va;
+        va_free[i].pages = pages;
+        va_free_count++;
+    } else {
+        // 空闲区间表已满，这段虚拟地址不再复用
+        serial_puts("kfree: heap extent table full, leaking virtual range\n");
+    }
+}
+
+// 缺页处理程序回调：落在空闲区间中的地址视为非法访问 (如释放后使用)
+static bool heap_va_reserved(uint64_t addr) {
+    for (uint32_t i = 0; i < va_free_count; i++) {
+        if (addr >= va_free[i].start && addr < va_free[i].start + va_free[i].pages * 4096) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 释放按需分页区间：取消映射并归还已经缺页分配的物理页。
+// 必须先取消映射并刷新 TLB 再释放，否则物理页被重新分配后仍可经旧地址写入。
+// 按批记录物理页，避免在释放路径上分配内存
+static void heap_release_demand(uint64_t va, uint64_t pages) {
+    pt_entry_t* pml4 = vmm_get_kernel_pml4();
+    uint64_t frames[HEAP_RELEASE_BATCH];
+
+    for (uint64_t done = 0; done < pages; ) {
+        uint64_t n = pages - done > HEAP_RELEASE_BATCH ? HEAP_RELEASE_BATCH : pages - done;
+        uint64_t start = va + done * 4096;
+
+        for (uint64_t i = 0; i < n; i++) {
+            frames[i] = vmm_translate(pml4, start + i * 4096);
+        }
+        vmm_unmap_range(pml4, start, n * 4096);
+        for (uint64_t i = 0; i < n; i++) {
+            if (frames[i]) pmm_free_page((void*)frames[i]);
+        }
+        done += n;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+    heap_va_free(va, pages);
+    demand_pages -= pages;
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+static inline bool is_demand_addr(void* ptr) {
+    uint64_t addr = (uint64_t)ptr;
+    return addr >= KERNEL_HEAP_BASE && addr < KERNEL_HEAP_BASE + KERNEL_HEAP_SIZE;
+}
+
+static void* kmalloc_large(uint32_t size) {
+    uint32_t pages = (size + SLAB_HEADER_SIZE + 4095) / 4096;
+    slab_t* slab = NULL;
+
+    // 优先只保留虚拟地址，写入页头时才真正分配第一页
+    if (demand_heap) {
+        uint64_t flags = spin_lock_irqsave(&heap_lock);
+        uint64_t va = heap_va_alloc(pages);
+        if (va) demand_pages += pages;
+        spin_unlock_irqrestore(&heap_lock, flags);
+        slab = (slab_t*)va;
+    }
+    if (!slab) slab = (slab_t*)pmm_alloc_blocks(pages);
+    if (!slab) return NULL;
+
+    slab->magic = SLAB_MAGIC;
+    slab->class_idx = SLAB_LARGE;
+    slab->in_use = 1;
+    slab->pages = pages;
+    slab->size = size;
+    slab->free_list = NULL;
+    slab->prev = NULL;
+    slab->next = NULL;
+
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+    large_pages += pages;
+    large_in_use++;
+    spin_unlock_irqrestore(&heap_lock, flags);
+
+    return (uint8_t*)slab + SLAB_HEADER_SIZE;
+}
+
+// 弹匣为空：从 slab 层批量取一半容量
+static void mag_refill(mem_magazine_t* mag, int class_idx) {
+    spin_lock(&heap_lock);
+    while (mag->count < MEM_MAG_BATCH) {
+        void* obj = slab_alloc_obj(class_idx);
+        if (!obj) break;
+        mag->objs[mag->count++] = obj;
+    }
+    spin_unlock(&heap_lock);
+}
+
+// 弹匣已满：把最早放入的一半批量归还给 slab 层
+static void mag_drain(mem_magazine_t* mag, int class_idx, uint32_t n) {
+    spin_lock(&heap_lock);
+    for (uint32_t i = 0; i < n; i++) {
+        slab_free_obj(class_idx, mag->objs[i]);
+    }
+    spin_unlock(&heap_lock);
+
+    for (uint32_t i = n; i < mag->count; i++) {
+        mag->objs[i - n] = mag->objs[i];
+    }
+    mag->count -= n;
 }
 
 void* kmalloc(uint32_t size) {
@@ -55,33 +433,42 @@ void* kmalloc(uint32_t size) {
         return NULL;
     }
 
-    uint32_t total_size = size + sizeof(alloc_info_t);
+    if (!heap_ready) mem_init();
+
+    void* ptr = NULL;
+    if (size > MEM_MAX_SMALL_SIZE) {
+        ptr = kmalloc_large(size);
+        if (ptr) {
+            uint64_t flags = cpu_irq_save();
+            cpu_caches[cpu_current_id()].allocs[MEM_CLASS_COUNT]++;
+            cpu_irq_restore(flags);
+        }
+    } else {
+        int idx = size_to_class(size);
 
-    total_size = (total_size + 7) & ~7;
+        // 关中断保证在本 CPU 上独占弹匣
+        uint64_t flags = cpu_irq_save();
+        mem_cpu_cache_t* cc = &cpu_caches[cpu_current_id()];
+        mem_magazine_t* mag = &cc->mags[idx];
+
+        if (mag->count == 0) mag_refill(mag, idx);
+        if (mag->count > 0) {
+            ptr = mag->objs[--mag->count];
+            cc->allocs[idx]++;
+        }
+        cpu_irq_restore(flags);
+    }
 
-    if (heap_used + total_size > HEAP_SIZE) {
+    if (!ptr) {
         serial_puts("kmalloc failed: out of memory! Requested ");
         serial_putdec32(size);
-        serial_puts(" bytes, available ");
-        serial_putdec32(HEAP_SIZE - heap_used);
         serial_puts(" bytes\n");
         return NULL;
     }
 
-    uint8_t* heap_base = get_heap_base();
-    alloc_info_t *info = (alloc_info_t*)(heap_base + heap_used);
-    info->size = size;
-    info->magic = ALLOC_MAGIC;
-
-    void *ptr = (void*)(info + 1);
-
-    heap_used += total_size;
-
-    serial_puts("kmalloc: allocated ");
-    serial_putdec32(size);
-    serial_puts(" bytes at 0x");
-    serial_puthex64((uint64_t)ptr);
-    serial_puts("\n");
+    if (trace_enabled) {
+        mem_trace_record(MEM_TRACE_ALLOC, (uint64_t)__builtin_return_address(0), ptr, size);
+    }
 
     return ptr;
 }
@@ -91,49 +478,139 @@ void kfree(void* ptr) {
         return;
     }
 
-    alloc_info_t *info = (alloc_info_t*)ptr - 1;
+    slab_t* slab = ptr_to_slab(ptr);
+    uint64_t offset = (uint64_t)ptr - (uint64_t)slab;
+
+    if (slab->magic != SLAB_MAGIC || offset < SLAB_HEADER_SIZE || slab->in_use == 0) {
+        serial_puts("kfree: invalid pointer or memory corruption detected!\n");
+        return;
+    }
+
+    if (slab->class_idx == SLAB_LARGE) {
+        if (offset != SLAB_HEADER_SIZE) {
+            serial_puts("kfree: invalid pointer or memory corruption detected!\n");
+            return;
+        }
+
+        if (trace_enabled) {
+            mem_trace_record(MEM_TRACE_FREE, (uint64_t)__builtin_return_address(0), ptr, slab->size);
+        }
+
+        uint32_t pages = slab->pages;
+        slab->magic = 0;
+        if (is_demand_addr(slab)) {
+            heap_release_demand((uint64_t)slab, pages);
+        } else {
+            pmm_free_blocks(slab, pages);
+        }
 
-    if (info->magic != ALLOC_MAGIC) {
+        uint64_t flags = spin_lock_irqsave(&heap_lock);
+        large_pages -= pages;
+        large_in_use--;
+        spin_unlock_irqrestore(&heap_lock, flags);
+
+        flags = cpu_irq_save();
+        cpu_caches[cpu_current_id()].frees[MEM_CLASS_COUNT]++;
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    int idx = slab->class_idx;
+    if ((offset - SLAB_HEADER_SIZE) % classes[idx].size != 0) {
         serial_puts("kfree: invalid pointer or memory corruption detected!\n");
         return;
     }
 
-    serial_puts("kfree: freed ");
-    serial_putdec32(info->size);
-    serial_puts(" bytes at 0x");
-    serial_puthex64((uint64_t)ptr);
-    serial_puts("\n");
+    if (trace_enabled) {
+        mem_trace_record(MEM_TRACE_FREE, (uint64_t)__builtin_return_address(0), ptr, classes[idx].size);
+    }
+
+    uint64_t flags = cpu_irq_save();
+    mem_cpu_cache_t* cc = &cpu_caches[cpu_current_id()];
+    mem_magazine_t* mag = &cc->mags[idx];
+
+    if (mag->count == MEM_MAG_SIZE) mag_drain(mag, idx, MEM_MAG_BATCH);
+    mag->objs[mag->count++] = ptr;
+    cc->frees[idx]++;
+    cpu_irq_restore(flags);
+}
+
+// 把当前 CPU 弹匣中的全部对象归还给 slab 层
+void mem_drain_cpu_cache(void) {
+    if (!heap_ready) return;
+
+    uint64_t flags = cpu_irq_save();
+    mem_cpu_cache_t* cc = &cpu_caches[cpu_current_id()];
+    for (int i = 0; i < MEM_CLASS_COUNT; i++) {
+        mem_magazine_t* mag = &cc->mags[i];
+        if (mag->count) mag_drain(mag, i, mag->count);
+    }
+    cpu_irq_restore(flags);
+}
+
+void mem_get_class_stats(int class_idx, mem_class_stats_t* out) {
+    if (!out) return;
+
+    bool large = class_idx < 0 || class_idx >= MEM_CLASS_COUNT;
+    int slot = large ? MEM_CLASS_COUNT : class_idx;
 
-    for (uint32_t i = 0; i < info->size; i++) {
-        ((uint8_t*)ptr)[i] = 0;
+    *out = (mem_class_stats_t){0};
+    out->size = large ? 0 : classes[class_idx].size;
+
+    for (int c = 0; c < MAX_CPUS; c++) {
+        out->allocs += cpu_caches[c].allocs[slot];
+        out->frees += cpu_caches[c].frees[slot];
+        if (!large) out->cached += cpu_caches[c].mags[class_idx].count;
     }
+    out->in_use = out->allocs - out->frees;
+
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+    out->slabs = large ? large_pages : classes[class_idx].slabs;
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
 
 void mem_info(void) {
-    serial_puts("\n=== Memory Information ===\n");
-    serial_puts("Heap base: 0x");
-    serial_puthex64(HEAP_BASE_ADDR);
-    serial_puts("\n");
-
-    serial_puts("Heap size: ");
-    serial_putdec32(HEAP_SIZE);
-    serial_puts(" bytes (");
-    serial_putdec32(HEAP_SIZE / 1024 / 1024);
-    serial_puts(" MB)\n");
-
-    serial_puts("Heap used: ");
-    serial_putdec32(heap_used);
-    serial_puts(" bytes (");
-    serial_putdec32(heap_used / 1024);
-    serial_puts(" KB)\n");
+    uint64_t total_bytes = 0;
+    uint64_t total_pages = 0;
+    mem_class_stats_t st;
+
+    serial_puts("\n=== Kernel Heap (slab) ===\n");
+    serial_puts("class   in-use  cached  allocs  frees   pages\n");
+
+    for (int i = 0; i <= MEM_CLASS_COUNT; i++) {
+        mem_get_class_stats(i, &st);
+
+        if (i < MEM_CLASS_COUNT) serial_putdec32(st.size);
+        else serial_puts("large");
+        serial_puts("\t");
+        serial_putdec32(st.in_use);
+        serial_puts("\t");
+        serial_putdec32(st.cached);
+        serial_puts("\t");
+        serial_putdec32(st.allocs);
+        serial_puts("\t");
+        serial_putdec32(st.frees);
+        serial_puts("\t");
+        serial_putdec32(st.slabs);
+        serial_puts("\n");
 
-    serial_puts("Heap free: ");
-    serial_putdec32(HEAP_SIZE - heap_used);
-    serial_puts(" bytes (");
-    serial_putdec32((HEAP_SIZE - heap_used) / 1024);
+        total_bytes += (uint64_t)st.in_use * st.size;
+        total_pages += st.slabs;
+    }
+
+    serial_puts("Small objects in use: ");
+    serial_putdec64(total_bytes / 1024);
+    serial_puts(" KB, heap pages: ");
+    serial_putdec64(total_pages);
+    serial_puts(" (");
+    serial_putdec64(total_pages * 4);
     serial_puts(" KB)\n");
 
-    serial_puts("Usage: ");
-    serial_putdec32(heap_used * 100 / HEAP_SIZE);
-    serial_puts("%\n");
+    if (demand_heap) {
+        serial_puts("Demand-paged heap: ");
+        serial_putdec64(demand_pages * 4);
+        serial_puts(" KB reserved, ");
+        serial_putdec64(vmm_get_demand_faults());
+        serial_puts(" page faults served\n");
+    }
 }
@@ -1,15 +1,88 @@
 #include "kernel.h"
 #include "stdint.h"
+#include "cpu.h"
+#include "acpi.h"
+
+// 伙伴系统：order k 的空闲块为 2^k 个连续页，按 2^k 页对齐。
+// 空闲块用嵌在页首的双向链表串起来（内核为恒等映射），
+// page_order[] 记录每个空闲块首页的阶数，位图记录页面是否已分配。
+// 两级摘要加速查找：free_order_mask 标记哪些阶有空闲块，配合 tzcnt 一步找到
+// 可拆分的最小阶；maxblk_map 以 64 位字记录哪些最大阶块空闲，大块分配时按字跳过，
+// 并从上次分配的位置 (轮转提示) 继续搜索。
+// NUMA：按 SRAT 把物理内存划分到各节点，每个节点一套独立的空闲链表 (zone)。
+// 空闲块不跨节点，page_order[] 的 bit4-6 记录块所属节点，合并时一并比较。
+// 分配优先本节点，不足时按 SLIT 距离由近到远回退。
+typedef struct free_block {
+    struct free_block *next;
+    struct free_block *prev;
+} free_block_t;
 
 static uint8_t *bitmap;
+static uint8_t *page_order;
 static uint64_t total_pages;
 static uint64_t free_pages;
 static uint64_t bitmap_size;
+static uint64_t *maxblk_map;
+static uint64_t maxblk_count;
+static uint64_t maxblk_hint;
+static spinlock_t pmm_lock;
+
+typedef struct {
+    free_block_t *free_area[PMM_MAX_ORDER + 1];
+    uint64_t free_count[PMM_MAX_ORDER + 1];
+    uint32_t free_order_mask;
+    uint64_t free_pages;
+    uint64_t present_pages;
+    uint32_t domain;                    // ACPI 邻近域编号
+    uint8_t fallback[PMM_MAX_NODES];    // 按距离排序的分配顺序，首项为自身
+} pmm_zone_t;
+
+typedef struct {
+    uint64_t start;     // 起始页号
+    uint64_t end;       // 结束页号 (不含)
+    uint32_t node;
+} pmm_node_range_t;
+
+#define PMM_MAX_NODE_RANGES 32
+
+static pmm_zone_t zones[PMM_MAX_NODES];
+static uint32_t node_count;
+static pmm_node_range_t node_ranges[PMM_MAX_NODE_RANGES];
+static uint32_t node_range_count;
+static uint8_t node_distance[PMM_MAX_NODES][PMM_MAX_NODES];
+static uint8_t cpu_node[MAX_CPUS];
+
+// 每 CPU 热页链表：单页分配/释放只操作本地链表，
+// 数量低于 low 时从伙伴系统批量补充，高于 high 时批量归还
+typedef struct {
+    free_block_t *head;
+    uint32_t count;
+    uint32_t low;
+    uint32_t high;
+    uint32_t batch;
+} __attribute__((aligned(64))) pmm_pcp_t;
+
+static pmm_pcp_t pcp_lists[MAX_CPUS];
+
+// 预清零页池：空闲循环中提前清零，pmm_alloc_zpage 直接取用。
+// 链表指针占用页首 8 字节，取出时再清掉
+static free_block_t *zero_pool;
+static uint32_t zero_pool_count;
+static spinlock_t zero_lock;
 
 #define SET_BIT(i) (bitmap[(i) / 8] |= (1 << ((i) % 8)))
 #define CLEAR_BIT(i) (bitmap[(i) / 8] &= ~(1 << ((i) % 8)))
 #define TEST_BIT(i) (bitmap[(i) / 8] & (1 << ((i) % 8)))
 
+#define PMM_LOW_LIMIT_PAGE  (0x1000000 / 4096)  // 前 16MB 保留给内核
+#define ORDER_FREE          0x80                // page_order 中表示空闲块首页
+#define ORDER_NODE_SHIFT    4                   // bit4-6: 空闲块所属节点
+#define ORDER_MASK          0x0F
+#define ORDER_PCP           0x40                // 页在某个 CPU 的热页链表上 (位图仍为已分配)
+
+#define NUMA_LOCAL_DISTANCE     10
+#define NUMA_REMOTE_DISTANCE    20
+
 static bool pmm_is_address_valid(uint64_t addr)
 {
     if (addr == 0 || addr == 0xFFFFFFFFFFFFFFFF)
@@ -19,6 +92,465 @@ static bool pmm_is_address_valid(uint64_t addr)
     return true;
 }
 
+static inline free_block_t *page_to_block(uint64_t page)
+{
+    return (free_block_t *)(page * 4096);
+}
+
+static inline uint64_t block_to_page(free_block_t *block)
+{
+    return (uint64_t)block / 4096;
+}
+
+static void bitmap_set_range(uint64_t start, uint64_t count)
+{
+    uint64_t i = start;
+    uint64_t end = start + count;
+
+    while (i < end && (i % 8) != 0)
+    {
+        SET_BIT(i);
+        i++;
+    }
+    if (end - i >= 8)
+    {
+        memset(&bitmap[i / 8], 0xFF, (end - i) / 8);
+        i += ((end - i) / 8) * 8;
+    }
+    while (i < end)
+    {
+        SET_BIT(i);
+        i++;
+    }
+}
+
+static void bitmap_clear_range(uint64_t start, uint64_t count)
+{
+    uint64_t i = start;
+    uint64_t end = start + count;
+
+    while (i < end && (i % 8) != 0)
+    {
+        CLEAR_BIT(i);
+        i++;
+    }
+    if (end - i >= 8)
+    {
+        memset(&bitmap[i / 8], 0x00, (end - i) / 8);
+        i += ((end - i) / 8) * 8;
+    }
+    while (i < end)
+    {
+        CLEAR_BIT(i);
+        i++;
+    }
+}
+
+static bool bitmap_range_set(uint64_t start, uint64_t count)
+{
+    for (uint64_t i = start; i < start + count; i++)
+    {
+        if (!TEST_BIT(i))
+            return false;
+    }
+    return true;
+}
+
+// 查找页所属节点，并返回该节点区间的结束页号，空闲块不得越过此边界。
+// SRAT 未覆盖的空洞归入节点 0
+static uint32_t page_to_node(uint64_t page, uint64_t *limit)
+{
+    for (uint32_t r = 0; r < node_range_count; r++)
+    {
+        if (page < node_ranges[r].start)
+        {
+            if (limit)
+                *limit = node_ranges[r].start;
+            return 0;
+        }
+        if (page < node_ranges[r].end)
+        {
+            if (limit)
+                *limit = node_ranges[r].end;
+            return node_ranges[r].node;
+        }
+    }
+    if (limit)
+        *limit = total_pages;
+    return 0;
+}
+
+static inline uint8_t order_tag(uint32_t node, uint32_t order)
+{
+    return ORDER_FREE | (node << ORDER_NODE_SHIFT) | order;
+}
+
+static void free_list_add(uint64_t page, uint32_t order, uint32_t node)
+{
+    pmm_zone_t *zone = &zones[node];
+    free_block_t *block = page_to_block(page);
+    block->prev = NULL;
+    block->next = zone->free_area[order];
+    if (zone->free_area[order])
+        zone->free_area[order]->prev = block;
+    zone->free_area[order] = block;
+
+    page_order[page] = order_tag(node, order);
+    zone->free_count[order]++;
+    zone->free_order_mask |= 1U << order;
+    zone->free_pages += 1ULL << order;
+    free_pages += 1ULL << order;
+
+    if (order == PMM_MAX_ORDER)
+    {
+        uint64_t b = page >> PMM_MAX_ORDER;
+        maxblk_map[b / 64] |= 1ULL << (b % 64);
+    }
+}
+
+static void free_list_remove(uint64_t page, uint32_t order)
+{
+    pmm_zone_t *zone = &zones[(page_order[page] & ~ORDER_FREE) >> ORDER_NODE_SHIFT];
+    free_block_t *block = page_to_block(page);
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        zone->free_area[order] = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+
+    page_order[page] = 0;
+    zone->free_count[order]--;
+    if (zone->free_area[order] == NULL)
+        zone->free_order_mask &= ~(1U << order);
+    zone->free_pages -= 1ULL << order;
+    free_pages -= 1ULL << order;
+
+    if (order == PMM_MAX_ORDER)
+    {
+        uint64_t b = page >> PMM_MAX_ORDER;
+        maxblk_map[b / 64] &= ~(1ULL << (b % 64));
+    }
+}
+
+// 释放一个已分配的 2^order 页块，并与空闲的伙伴逐级合并
+static void buddy_free(uint64_t page, uint32_t order)
+{
+    uint32_t node = page_to_node(page, NULL);
+    bitmap_clear_range(page, 1ULL << order);
+
+    while (order < PMM_MAX_ORDER)
+    {
+        uint64_t buddy = page ^ (1ULL << order);
+        // 伙伴必须同阶空闲且属于同一节点
+        if (buddy + (1ULL << order) > total_pages || page_order[buddy] != order_tag(node, order))
+            break;
+
+        free_list_remove(buddy, order);
+        if (buddy < page)
+            page = buddy;
+        order++;
+    }
+
+    free_list_add(page, order, node);
+}
+
+// 从指定节点分配一个 2^order 页块，必要时拆分更高阶的块
+static int64_t buddy_alloc_node(uint32_t node, uint32_t order)
+{
+    pmm_zone_t *zone = &zones[node];
+
+    // 不小于 order 的最低非空阶
+    uint32_t avail = zone->free_order_mask & ~((1U << order) - 1);
+    if (avail == 0)
+        return -1;
+    uint32_t k = __builtin_ctz(avail);
+
+    uint64_t page = block_to_page(zone->free_area[k]);
+    free_list_remove(page, k);
+
+    // 高阶块对半拆分，后半部分挂回低一阶的空闲链表
+    while (k > order)
+    {
+        k--;
+        free_list_add(page + (1ULL << k), k, node);
+    }
+
+    bitmap_set_range(page, 1ULL << order);
+    return (int64_t)page;
+}
+
+// 优先从 node 分配，失败时按距离顺序回退到其他节点
+static int64_t buddy_alloc(uint32_t node, uint32_t order)
+{
+    pmm_zone_t *zone = &zones[node];
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        int64_t page = buddy_alloc_node(zone->fallback[i], order);
+        if (page >= 0)
+            return page;
+    }
+    return -1;
+}
+
+// 把任意页区间拆成尽可能大的对齐块释放
+static void buddy_free_range(uint64_t page, uint64_t count)
+{
+    while (count > 0)
+    {
+        // 块不能越过节点边界
+        uint64_t limit;
+        page_to_node(page, &limit);
+        uint64_t span = limit - page < count ? limit - page : count;
+
+        uint32_t order = 0;
+        while (order < PMM_MAX_ORDER &&
+               (page & ((2ULL << order) - 1)) == 0 &&
+               (2ULL << order) <= span)
+            order++;
+
+        if (bitmap_range_set(page, 1ULL << order))
+        {
+            buddy_free(page, order);
+        }
+        else
+        {
+            // 区间内有未分配的页（重复释放），逐页处理已分配的部分
+            for (uint64_t i = page; i < page + (1ULL << order); i++)
+            {
+                if (TEST_BIT(i))
+                    buddy_free(i, 0);
+            }
+        }
+
+        page += 1ULL << order;
+        count -= 1ULL << order;
+    }
+}
+
+static inline uint32_t count_to_order(size_t count)
+{
+    uint32_t order = 0;
+    while ((1ULL << order) < count)
+        order++;
+    return order;
+}
+
+// 邻近域编号映射为连续的节点号，新域按出现顺序分配
+static int numa_domain_to_node(uint32_t domain)
+{
+    for (uint32_t n = 0; n < node_count; n++)
+    {
+        if (zones[n].domain == domain)
+            return (int)n;
+    }
+    if (node_count >= PMM_MAX_NODES)
+        return -1;
+    zones[node_count].domain = domain;
+    return (int)node_count++;
+}
+
+// 按起始页号有序插入一个节点区间
+static void numa_add_range(uint64_t start, uint64_t end, uint32_t node)
+{
+    if (end > total_pages)
+        end = total_pages;
+    if (start >= end)
+        return;
+    if (node_range_count >= PMM_MAX_NODE_RANGES)
+    {
+        serial_puts("PMM: too many SRAT memory ranges, ignoring\n");
+        return;
+    }
+
+    uint32_t r = node_range_count++;
+    while (r > 0 && node_ranges[r - 1].start > start)
+    {
+        node_ranges[r] = node_ranges[r - 1];
+        r--;
+    }
+    node_ranges[r].start = start;
+    node_ranges[r].end = end;
+    node_ranges[r].node = node;
+}
+
+static uint32_t bsp_apic_id(void)
+{
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    return ebx >> 24;
+}
+
+// 解析 SRAT/SLIT 建立节点、内存区间、距离矩阵和回退顺序。
+// 没有 SRAT 时整个物理内存为节点 0
+static void pmm_numa_init(void)
+{
+    memset(zones, 0, sizeof(zones));
+    node_count = 0;
+    node_range_count = 0;
+    for (int c = 0; c < MAX_CPUS; c++)
+        cpu_node[c] = 0;
+
+    acpi_srat_t *srat = (acpi_srat_t *)acpi_find_table("SRAT");
+    if (srat)
+    {
+        uint32_t bsp = bsp_apic_id();
+        uint8_t *p = (uint8_t *)srat + sizeof(acpi_srat_t);
+        uint8_t *end = (uint8_t *)srat + srat->header.length;
+
+        while (p + sizeof(acpi_srat_entry_t) <= end)
+        {
+            acpi_srat_entry_t *entry = (acpi_srat_entry_t *)p;
+            if (entry->length == 0 || p + entry->length > end)
+                break;
+
+            if (entry->type == SRAT_TYPE_MEMORY_AFFINITY)
+            {
+                acpi_srat_mem_t *mem = (acpi_srat_mem_t *)entry;
+                if ((mem->flags & SRAT_FLAG_ENABLED) && mem->size)
+                {
+                    int node = numa_domain_to_node(mem->domain);
+                    if (node >= 0)
+                        numa_add_range(mem->base / 4096, (mem->base + mem->size) / 4096, node);
+                }
+            }
+            else if (entry->type == SRAT_TYPE_CPU_AFFINITY)
+            {
+                acpi_srat_cpu_t *cpu = (acpi_srat_cpu_t *)entry;
+                if ((cpu->flags & SRAT_FLAG_ENABLED) && cpu->apic_id == bsp)
+                {
+                    uint32_t domain = cpu->domain_lo | (cpu->domain_hi[0] << 8) |
+                                      (cpu->domain_hi[1] << 16) | ((uint32_t)cpu->domain_hi[2] << 24);
+                    int node = numa_domain_to_node(domain);
+                    if (node >= 0)
+                        cpu_node[0] = node;
+                }
+            }
+            else if (entry->type == SRAT_TYPE_X2APIC_AFFINITY)
+            {
+                acpi_srat_x2apic_t *cpu = (acpi_srat_x2apic_t *)entry;
+                if ((cpu->flags & SRAT_FLAG_ENABLED) && cpu->x2apic_id == bsp)
+                {
+                    int node = numa_domain_to_node(cpu->domain);
+                    if (node >= 0)
+                        cpu_node[0] = node;
+                }
+            }
+
+            p += entry->length;
+        }
+    }
+
+    if (node_count == 0)
+        node_count = 1;
+
+    // 默认距离，SLIT 存在时以其为准 (SLIT 按邻近域编号索引)
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        for (uint32_t j = 0; j < node_count; j++)
+            node_distance[i][j] = (i == j) ? NUMA_LOCAL_DISTANCE : NUMA_REMOTE_DISTANCE;
+    }
+
+    acpi_slit_t *slit = (acpi_slit_t *)acpi_find_table("SLIT");
+    if (slit)
+    {
+        uint64_t n = slit->locality_count;
+        for (uint32_t i = 0; i < node_count; i++)
+        {
+            for (uint32_t j = 0; j < node_count; j++)
+            {
+                uint64_t di = zones[i].domain;
+                uint64_t dj = zones[j].domain;
+                if (di < n && dj < n &&
+                    sizeof(acpi_slit_t) + di * n + dj < slit->header.length)
+                    node_distance[i][j] = slit->entries[di * n + dj];
+            }
+        }
+    }
+
+    // 每个节点的回退顺序：按距离升序，距离相同时按节点号
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        uint8_t *order = zones[i].fallback;
+        for (uint32_t j = 0; j < node_count; j++)
+        {
+            uint32_t k = j;
+            while (k > 0 && node_distance[i][order[k - 1]] > node_distance[i][j])
+            {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = j;
+        }
+    }
+}
+
+static inline void reserve_page(uint64_t addr)
+{
+    uint64_t page = addr / 4096;
+    if (page < total_pages)
+        SET_BIT(page);
+}
+
+// 在 vmm_init 切换页表之前仍运行在启动页表上，其下级页表多位于
+// BootServicesData 中。伙伴系统会在空闲页首写入链表指针，必须先把这些页表页保留下来
+static void pmm_reserve_page_tables(void)
+{
+    uint64_t cr3 = cpu_read_cr3() & PTE_ADDR_MASK;
+    if (cr3 == 0)
+        return;
+
+    pt_entry_t *pml4 = (pt_entry_t *)cr3;
+    reserve_page(cr3);
+    for (int i = 0; i < 512; i++)
+    {
+        if (!(pml4[i] & PTE_PRESENT))
+            continue;
+        pt_entry_t *pdpt = (pt_entry_t *)(pml4[i] & PTE_ADDR_MASK);
+        reserve_page((uint64_t)pdpt);
+
+        for (int j = 0; j < 512; j++)
+        {
+            if (!(pdpt[j] & PTE_PRESENT) || (pdpt[j] & PTE_HUGE))
+                continue;
+            pt_entry_t *pd = (pt_entry_t *)(pdpt[j] & PTE_ADDR_MASK);
+            reserve_page((uint64_t)pd);
+
+            for (int k = 0; k < 512; k++)
+            {
+                if ((pd[k] & PTE_PRESENT) && !(pd[k] & PTE_HUGE))
+                    reserve_page(pd[k] & PTE_ADDR_MASK);
+            }
+        }
+    }
+}
+
+// 当前栈所在的整个内存描述符保留下来。entry.asm 已切换到内核映像中的栈，
+// 这里防止栈仍位于 BootServicesData 中时被当作空闲页写入链表指针
+static void pmm_reserve_stack(uint8_t *mmap_ptr, size_t desc_count, size_t desc_size)
+{
+    uint64_t rsp;
+    asm volatile("mov %%rsp, %0" : "=r"(rsp));
+    if (rsp >= KERNEL_VMA)
+        rsp -= KERNEL_VMA;
+
+    for (size_t i = 0; i < desc_count; i++)
+    {
+        efi_mem_desc_t *d = (efi_mem_desc_t *)(mmap_ptr + (i * desc_size));
+        uint64_t end = d->physical_start + d->number_of_pages * 4096;
+        if (rsp >= d->physical_start && rsp < end)
+        {
+            uint64_t start_page = d->physical_start / 4096;
+            uint64_t end_page = end / 4096;
+            if (end_page > total_pages)
+                end_page = total_pages;
+            if (start_page < end_page)
+                bitmap_set_range(start_page, end_page - start_page);
+            return;
+        }
+    }
+}
+
 void pmm_init(void *mmap, size_t mmap_size, size_t desc_size)
 {
     if (desc_size == 0)
@@ -43,11 +575,16 @@ void pmm_init(void *mmap, size_t mmap_size, size_t desc_size)
     bitmap_size = (total_pages + 7) / 8;
     bitmap = NULL;
 
+    // 元数据：最大阶块摘要位图 + 分配位图 + 每页一个字节的阶数表
+    maxblk_count = total_pages >> PMM_MAX_ORDER;
+    uint64_t maxblk_words = (maxblk_count + 63) / 64;
+    uint64_t meta_size = maxblk_words * 8 + bitmap_size + total_pages;
+
     for (size_t i = 0; i < desc_count; i++)
     {
         efi_mem_desc_t *d = (efi_mem_desc_t *)(mmap_ptr + (i * desc_size));
         // 类型 7: EfiConventionalMemory
-        if (d->type == 7 && (d->number_of_pages * 4096) >= bitmap_size)
+        if (d->type == 7 && (d->number_of_pages * 4096) >= meta_size)
         {
             if (d->physical_start >= 0x1000000)
             {
@@ -57,8 +594,35 @@ void pmm_init(void *mmap, size_t mmap_size, size_t desc_size)
         }
     }
 
+    if (bitmap == NULL)
+    {
+        serial_puts("FATAL: no room for PMM metadata!\n");
+        while (1);
+    }
+
+    // 摘要位图放在最前面，保证 8 字节对齐
+    maxblk_map = (uint64_t *)bitmap;
+    bitmap = (uint8_t *)(maxblk_map + maxblk_words);
+    page_order = bitmap + bitmap_size;
+    memset(maxblk_map, 0, maxblk_words * 8);
     memset(bitmap, 0xFF, bitmap_size);
+    memset(page_order, 0, total_pages);
+    pmm_numa_init();
+    maxblk_hint = 0;
     free_pages = 0;
+    pmm_lock = (spinlock_t)SPINLOCK_INIT;
+    zero_lock = (spinlock_t)SPINLOCK_INIT;
+    zero_pool = NULL;
+    zero_pool_count = 0;
+
+    for (int c = 0; c < MAX_CPUS; c++)
+    {
+        pcp_lists[c].head = NULL;
+        pcp_lists[c].count = 0;
+        pcp_lists[c].low = PMM_PCP_LOW;
+        pcp_lists[c].high = PMM_PCP_HIGH;
+        pcp_lists[c].batch = PMM_PCP_BATCH;
+    }
 
     for (size_t i = 0; i < desc_count; i++)
     {
@@ -70,190 +634,404 @@ void pmm_init(void *mmap, size_t mmap_size, size_t desc_size)
             uint64_t end_page = start_page + d->number_of_pages;
             if (end_page > total_pages)
                 end_page = total_pages;
-            
+
             if (start_page >= end_page)
                 continue;
-            
-            // 优化：批量处理完整字节
-            uint64_t start_byte = start_page / 8;
-            uint64_t end_byte = (end_page - 1) / 8;
-            
-            // 处理开头不完整的字节
-            if (start_page % 8 != 0)
-            {
-                uint8_t mask = 0xFF << (start_page % 8);
-                bitmap[start_byte] &= ~mask;
-                start_byte++;
-            }
-            
-            // 批量处理完整字节
-            if (start_byte < end_byte)
-            {
-                memset(&bitmap[start_byte], 0x00, end_byte - start_byte);
-            }
-            
-            // 处理结尾不完整的字节
-            if (end_byte == start_byte - 1) // 只有部分字节需要处理
-            {
-                uint8_t mask = 0xFF >> (8 - (end_page % 8));
-                if (end_page % 8 != 0)
-                    bitmap[end_byte] &= ~mask;
-            }
-            
-            // 更新空闲页计数
-            free_pages += (end_page - start_page);
+
+            bitmap_clear_range(start_page, end_page - start_page);
         }
     }
 
     // 保护前 16MB 内核区
-    uint64_t kernel_safety_pages = 0x1000000 / 4096;
-    for (uint64_t i = 0; i < kernel_safety_pages && i < total_pages; i++)
+    bitmap_set_range(0, PMM_LOW_LIMIT_PAGE < total_pages ? PMM_LOW_LIMIT_PAGE : total_pages);
+
+    // 保护元数据自身
+    uint64_t meta_start_page = (uint64_t)maxblk_map / 4096;
+    uint64_t meta_pages = (meta_size + 4095) / 4096;
+    bitmap_set_range(meta_start_page, meta_pages);
+
+    // 保护当前正在使用的页表和栈
+    pmm_reserve_page_tables();
+    pmm_reserve_stack(mmap_ptr, desc_count, desc_size);
+
+    // 把位图中的空闲区间按最大对齐块挂入伙伴系统
+    uint64_t i = PMM_LOW_LIMIT_PAGE;
+    while (i < total_pages)
     {
-        if (!TEST_BIT(i))
+        if ((i % 8) == 0 && i + 8 <= total_pages && bitmap[i / 8] == 0xFF)
+        {
+            i += 8;
+            continue;
+        }
+        if (TEST_BIT(i))
         {
-            SET_BIT(i);
-            free_pages--;
+            i++;
+            continue;
         }
+
+        uint64_t run_start = i;
+        while (i < total_pages && !TEST_BIT(i))
+            i++;
+
+        // buddy_free 需要页处于已分配状态
+        bitmap_set_range(run_start, i - run_start);
+        buddy_free_range(run_start, i - run_start);
     }
 
-    // 保护位图自身
-    uint64_t bitmap_start_page = (uint64_t)bitmap / 4096;
-    uint64_t bitmap_pages = (bitmap_size + 4095) / 4096;
-    for (uint64_t i = 0; i < bitmap_pages; i++)
+    serial_puts("PMM: buddy allocator ready, ");
+    serial_putdec64(free_pages * 4 / 1024);
+    serial_puts(" MB free\n");
+
+    for (uint32_t n = 0; n < node_count; n++)
     {
-        if (bitmap_start_page + i < total_pages && !TEST_BIT(bitmap_start_page + i))
-        {
-            SET_BIT(bitmap_start_page + i);
-            free_pages--;
-        }
+        zones[n].present_pages = zones[n].free_pages;
+        serial_puts("PMM: node ");
+        serial_putdec32(n);
+        serial_puts(" (domain ");
+        serial_putdec32(zones[n].domain);
+        serial_puts("): ");
+        serial_putdec64(zones[n].free_pages * 4 / 1024);
+        serial_puts(" MB\n");
     }
 }
 
-void *pmm_alloc_page()
+// 从伙伴系统取一批单页补充本地链表，调用者已关中断
+static void pcp_refill(pmm_pcp_t *pcp, uint32_t node)
 {
-    uint64_t start_search = 0x1000000 / 4096;
-    uint64_t start_byte = start_search / 8;
-    uint64_t end_byte = total_pages / 8;
-    
-    // 优化：先按字节搜索，再按位搜索
-    for (uint64_t i = start_byte; i < end_byte; i++)
+    uint32_t target = pcp->low + pcp->batch;
+
+    spin_lock(&pmm_lock);
+    while (pcp->count < target)
     {
-        if (bitmap[i] != 0xFF) // 该字节中存在空闲位
-        {
-            // 找到第一个空闲位
-            for (uint8_t j = 0; j < 8; j++)
-            {
-                uint64_t page_index = i * 8 + j;
-                if (page_index >= total_pages) break;
-                if (!TEST_BIT(page_index))
-                {
-                    uint64_t addr = page_index * 4096;
-                    if (!pmm_is_address_valid(addr))
-                        continue;
-                    SET_BIT(page_index);
-                    free_pages--;
-                    return (void *)addr;
-                }
-            }
-        }
+        int64_t page = buddy_alloc(node, 0);
+        if (page < 0)
+            break;
+
+        free_block_t *block = page_to_block((uint64_t)page);
+        page_order[page] = ORDER_PCP;
+        block->next = pcp->head;
+        pcp->head = block;
+        pcp->count++;
+    }
+    spin_unlock(&pmm_lock);
+}
+
+// 把本地链表中的 n 页归还伙伴系统，调用者已关中断
+static void pcp_drain(pmm_pcp_t *pcp, uint32_t n)
+{
+    spin_lock(&pmm_lock);
+    while (n-- > 0 && pcp->head)
+    {
+        free_block_t *block = pcp->head;
+        pcp->head = block->next;
+        pcp->count--;
+        page_order[block_to_page(block)] = 0;
+        buddy_free(block_to_page(block), 0);
     }
-    
-    // 处理剩余的位
-    uint64_t last_byte = total_pages / 8;
-    for (uint64_t i = last_byte * 8; i < total_pages; i++)
+    spin_unlock(&pmm_lock);
+}
+
+static void *zero_pool_pop()
+{
+    uint64_t flags = spin_lock_irqsave(&zero_lock);
+    free_block_t *block = zero_pool;
+    if (block)
     {
-        if (!TEST_BIT(i))
-        {
-            uint64_t addr = i * 4096;
-            if (!pmm_is_address_valid(addr))
-                continue;
-            SET_BIT(i);
-            free_pages--;
-            return (void *)addr;
-        }
+        zero_pool = block->next;
+        zero_pool_count--;
+    }
+    spin_unlock_irqrestore(&zero_lock, flags);
+
+    if (block)
+        block->next = NULL;
+    return block;
+}
+
+// 按 8 字节清零整页，比逐字节 memset 快得多
+static inline void page_clear(void *page)
+{
+    uint64_t count = 4096 / 8;
+    asm volatile("rep stosq" : "+D"(page), "+c"(count) : "a"(0ULL) : "memory");
+}
+
+void *pmm_alloc_page()
+{
+    uint64_t flags = cpu_irq_save();
+    uint32_t cpu = cpu_current_id();
+    pmm_pcp_t *pcp = &pcp_lists[cpu];
+
+    if (pcp->count <= pcp->low)
+        pcp_refill(pcp, cpu_node[cpu]);
+
+    free_block_t *block = pcp->head;
+    if (block)
+    {
+        pcp->head = block->next;
+        pcp->count--;
+        page_order[block_to_page(block)] = 0;
     }
-    
-    return NULL;
+    cpu_irq_restore(flags);
+
+    // 伙伴系统耗尽时动用预清零页池
+    if (block == NULL)
+        block = zero_pool_pop();
+    if (block == NULL)
+        return NULL;
+
+    uint64_t addr = (uint64_t)block;
+    if (!pmm_is_address_valid(addr))
+        return NULL;
+    return (void *)addr;
 }
 
-// 分配并清零页面，用于页表创建
+// 分配并清零页面，用于页表创建。优先取预清零页，池空时当场清零
 void *pmm_alloc_zpage()
 {
-    void *addr = pmm_alloc_page();
+    void *addr = zero_pool_pop();
     if (addr)
-        memset(addr, 0, 4096);
+        return addr;
+
+    addr = pmm_alloc_page();
+    if (addr)
+        page_clear(addr);
     return addr;
 }
 
-// 分配多块连续物理页，用于双缓冲等大内存需求
-void *pmm_alloc_blocks(size_t count)
+// 在空闲时补充预清零页池，每次最多处理 max_pages 页，返回本次清零的页数
+uint32_t pmm_zero_pool_refill(uint32_t max_pages)
 {
-    if (count == 0) return NULL;
-    if (count > free_pages) return NULL;
-    
-    uint64_t start_search = 0x1000000 / 4096;
-    uint64_t consecutive = 0;
-    uint64_t start_index = 0;
+    uint32_t done = 0;
 
-    // 优化：使用快速位搜索
-    for (uint64_t i = start_search; i < total_pages; i++)
+    while (done < max_pages && zero_pool_count < PMM_ZERO_POOL_TARGET)
     {
-        if (!TEST_BIT(i))
+        // 保留余量给普通分配
+        if (free_pages < PMM_ZERO_POOL_RESERVE)
+            break;
+
+        free_block_t *block = pmm_alloc_page();
+        if (block == NULL)
+            break;
+        page_clear(block);
+
+        uint64_t flags = spin_lock_irqsave(&zero_lock);
+        block->next = zero_pool;
+        zero_pool = block;
+        zero_pool_count++;
+        spin_unlock_irqrestore(&zero_lock, flags);
+        done++;
+    }
+    return done;
+}
+
+// 把预清零页全部归还，供内存紧张时回收
+void pmm_zero_pool_drain()
+{
+    void *page;
+    while ((page = zero_pool_pop()) != NULL)
+        pmm_free_page(page);
+}
+
+uint32_t pmm_zero_pool_count()
+{
+    return zero_pool_count;
+}
+
+// 在摘要位图 [lo, hi) 中查找 want 个连续置位的块：全零字整字跳过，
+// 用 tzcnt 定位下一个空闲块和下一个已占用块
+static int64_t maxblk_find_run(uint64_t want, uint64_t lo, uint64_t hi)
+{
+    uint64_t b = lo;
+
+    while (b + want <= hi)
+    {
+        uint64_t w = b / 64;
+        uint64_t bits = maxblk_map[w] & (~0ULL << (b % 64));
+        while (bits == 0)
         {
-            if (consecutive == 0)
-                start_index = i;
-            consecutive++;
-            
-            if (consecutive == count)
-            {
-                // 批量设置位
-                uint64_t end_index = start_index + count;
-                uint64_t start_byte = start_index / 8;
-                uint64_t end_byte = (end_index - 1) / 8;
-                
-                // 处理开头不完整的字节
-                if (start_index % 8 != 0)
-                {
-                    uint8_t mask = 0xFF << (start_index % 8);
-                    bitmap[start_byte] |= mask;
-                    start_byte++;
-                }
-                
-                // 批量处理完整字节
-                if (start_byte < end_byte)
-                {
-                    memset(&bitmap[start_byte], 0xFF, end_byte - start_byte);
-                }
-                
-                // 处理结尾不完整的字节
-                if (end_index % 8 != 0)
-                {
-                    uint8_t mask = 0xFF >> (8 - (end_index % 8));
-                    bitmap[end_byte] |= mask;
-                }
-                
-                free_pages -= count;
-                return (void *)(start_index * 4096);
-            }
+            w++;
+            if (w * 64 >= hi)
+                return -1;
+            bits = maxblk_map[w];
         }
-        else
+        b = w * 64 + __builtin_ctzll(bits);
+        if (b + want > hi)
+            return -1;
+
+        // 从 b 开始查找第一个非空闲块
+        uint64_t end = b + want;
+        uint64_t e = b;
+        while (e < end)
         {
-            consecutive = 0;
+            w = e / 64;
+            uint64_t holes = ~maxblk_map[w] & (~0ULL << (e % 64));
+            if (holes == 0)
+            {
+                e = (w + 1) * 64;
+                continue;
+            }
+            e = w * 64 + __builtin_ctzll(holes);
+            break;
         }
+
+        if (e >= end)
+            return (int64_t)b;
+        b = e + 1;
+    }
+    return -1;
+}
+
+// 超过最大阶的请求：寻找物理连续的若干最大阶空闲块
+// 优先在 node 的内存区间内查找，找不到再全局查找
+static void *pmm_alloc_huge(uint32_t node, size_t count)
+{
+    uint64_t block_pages = 1ULL << PMM_MAX_ORDER;
+    uint64_t blocks = (count + block_pages - 1) / block_pages;
+
+    int64_t first = -1;
+    for (uint32_t r = 0; r < node_range_count && first < 0; r++)
+    {
+        if (node_ranges[r].node != node)
+            continue;
+        uint64_t lo = (node_ranges[r].start + block_pages - 1) >> PMM_MAX_ORDER;
+        uint64_t hi = node_ranges[r].end >> PMM_MAX_ORDER;
+        if (lo < hi)
+            first = maxblk_find_run(blocks, lo, hi);
     }
-    return NULL;
+    if (first < 0)
+        first = maxblk_find_run(blocks, maxblk_hint, maxblk_count);
+    if (first < 0)
+        first = maxblk_find_run(blocks, 0, maxblk_count);
+    if (first < 0)
+        return NULL;
+
+    uint64_t start = (uint64_t)first << PMM_MAX_ORDER;
+    for (uint64_t b = 0; b < blocks; b++)
+        free_list_remove(start + b * block_pages, PMM_MAX_ORDER);
+
+    bitmap_set_range(start, blocks * block_pages);
+    maxblk_hint = (uint64_t)first + blocks;
+
+    // 归还多余的尾部
+    uint64_t excess = blocks * block_pages - count;
+    if (excess)
+        buddy_free_range(start + count, excess);
+
+    return (void *)(start * 4096);
+}
+
+// 分配多块连续物理页，用于双缓冲等大内存需求
+static void *pmm_alloc_blocks_locked(uint32_t node, size_t count)
+{
+    if (count > free_pages) return NULL;
+
+    if (count > (1ULL << PMM_MAX_ORDER))
+        return pmm_alloc_huge(node, count);
+
+    uint32_t order = count_to_order(count);
+    int64_t page = buddy_alloc(node, order);
+    if (page < 0)
+        return NULL;
+
+    // 向上取整到 2 的幂后多出的尾部立即归还
+    uint64_t excess = (1ULL << order) - count;
+    if (excess)
+        buddy_free_range((uint64_t)page + count, excess);
+
+    return (void *)((uint64_t)page * 4096);
+}
+
+void *pmm_alloc_blocks(size_t count)
+{
+    return pmm_alloc_blocks_node(pmm_local_node(), count);
+}
+
+// 在指定节点分配，节点内存不足时按距离回退
+void *pmm_alloc_blocks_node(uint32_t node, size_t count)
+{
+    if (count == 0) return NULL;
+    if (node >= node_count)
+        node = pmm_local_node();
+
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+    void *addr = pmm_alloc_blocks_locked(node, count);
+    spin_unlock_irqrestore(&pmm_lock, flags);
+
+    if (addr == NULL)
+    {
+        // 预清零页和本 CPU 缓存的单页可能阻碍了合并，归还后重试
+        pmm_zero_pool_drain();
+        pmm_drain_local();
+        flags = spin_lock_irqsave(&pmm_lock);
+        addr = pmm_alloc_blocks_locked(node, count);
+        spin_unlock_irqrestore(&pmm_lock, flags);
+    }
+    return addr;
 }
 
 void pmm_free_page(void *addr)
 {
     uint64_t page_index = (uint64_t)addr / 4096;
-    if (page_index >= (0x1000000 / 4096) && page_index < total_pages)
+    if (page_index < PMM_LOW_LIMIT_PAGE || page_index >= total_pages)
+        return;
+    if (!TEST_BIT(page_index))
+        return;
+
+    uint64_t flags = cpu_irq_save();
+    uint32_t cpu = cpu_current_id();
+    pmm_pcp_t *pcp = &pcp_lists[cpu];
+
+    // 远端节点的页直接还给其所属节点，不进入本地缓存
+    if (page_to_node(page_index, NULL) != cpu_node[cpu])
     {
-        if (TEST_BIT(page_index))
-        {
-            CLEAR_BIT(page_index);
-            free_pages++;
-        }
+        spin_lock(&pmm_lock);
+        buddy_free(page_index, 0);
+        spin_unlock(&pmm_lock);
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    // 热页链表上的页位图仍为已分配，靠 ORDER_PCP 标记识别重复释放，
+    // 否则同一页会被压入链表两次而形成环
+    if (__atomic_exchange_n(&page_order[page_index], ORDER_PCP, __ATOMIC_ACQ_REL) == ORDER_PCP)
+    {
+        cpu_irq_restore(flags);
+        serial_puts("PMM: double free of page 0x");
+        serial_puthex64(page_index * 4096);
+        serial_puts("\n");
+        return;
+    }
+
+    free_block_t *block = page_to_block(page_index);
+    block->next = pcp->head;
+    pcp->head = block;
+    pcp->count++;
+
+    if (pcp->count > pcp->high)
+        pcp_drain(pcp, pcp->batch);
+    cpu_irq_restore(flags);
+}
+
+// 把当前 CPU 缓存的全部单页归还伙伴系统
+void pmm_drain_local()
+{
+    uint64_t flags = cpu_irq_save();
+    pmm_pcp_t *pcp = &pcp_lists[cpu_current_id()];
+    if (pcp->count)
+        pcp_drain(pcp, pcp->count);
+    cpu_irq_restore(flags);
+}
+
+// 调整所有 CPU 热页链表的水位线
+void pmm_set_pcp_watermarks(uint32_t low, uint32_t high, uint32_t batch)
+{
+    if (batch == 0 || high < low + batch)
+        return;
+
+    for (int c = 0; c < MAX_CPUS; c++)
+    {
+        pcp_lists[c].low = low;
+        pcp_lists[c].high = high;
+        pcp_lists[c].batch = batch;
     }
 }
 
@@ -261,8 +1039,72 @@ void pmm_free_page(void *addr)
 void pmm_free_blocks(void *addr, size_t count)
 {
     uint64_t start_index = (uint64_t)addr / 4096;
-    for (uint64_t i = 0; i < count; i++)
-    {
-        pmm_free_page((void *)((start_index + i) * 4096));
-    }
-}
\ No newline at end of file
+    if (start_index < PMM_LOW_LIMIT_PAGE || start_index + count > total_pages)
+        return;
+
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+    buddy_free_range(start_index, count);
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+uint64_t pmm_get_total_memory()
+{
+    return total_pages * 4096;
+}
+
+// 含各 CPU 热页链表和预清零池中的页
+uint64_t pmm_get_free_memory()
+{
+    uint64_t pages = free_pages + zero_pool_count;
+    for (int c = 0; c < MAX_CPUS; c++)
+        pages += pcp_lists[c].count;
+    return pages * 4096;
+}
+
+uint64_t pmm_get_free_blocks(uint32_t order)
+{
+    if (order > PMM_MAX_ORDER)
+        return 0;
+
+    uint64_t count = 0;
+    for (uint32_t n = 0; n < node_count; n++)
+        count += zones[n].free_count[order];
+    return count;
+}
+
+uint32_t pmm_numa_node_count()
+{
+    return node_count;
+}
+
+uint32_t pmm_local_node()
+{
+    return cpu_node[cpu_current_id()];
+}
+
+uint32_t pmm_addr_to_node(void *addr)
+{
+    return page_to_node((uint64_t)addr / 4096, NULL);
+}
+
+uint32_t pmm_node_distance(uint32_t from, uint32_t to)
+{
+    if (from >= node_count || to >= node_count)
+        return 0;
+    return node_distance[from][to];
+}
+
+// 不含各 CPU 热页链表中缓存的页
+uint64_t pmm_get_node_free_memory(uint32_t node)
+{
+    if (node >= node_count)
+        return 0;
+    return zones[node].free_pages * 4096;
+}
+
+uint64_t pmm_get_node_total_memory(uint32_t node)
+{
+    if (node >= node_count)
+        return 0;
+    return zones[node].present_pages * 4096;
+}
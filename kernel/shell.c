@@ -1,5 +1,9 @@
 #include "shell.h"
 #include "serial.h"
+#include "drivers/bcache.h"
+#include "drivers/fs/pcache.h"
+#include "drivers/blkdev.h"
+#include "memory.h"
 #include <stdarg.h>
 
 static void shell_memcpy(void *dest, const void *src, size_t n) {
@@ -317,6 +321,11 @@ static void cmd_reboot(int argc, char *argv[]);
 static void cmd_shutdown(int argc, char *argv[]);
 static void cmd_history(int argc, char *argv[]);
 static void cmd_list_dir(int argc, char *argv[]);
+static void cmd_bcache(int argc, char *argv[]);
+static void cmd_pcache(int argc, char *argv[]);
+static void cmd_sync(int argc, char *argv[]);
+static void cmd_blkdev(int argc, char *argv[]);
+static void cmd_memtrace(int argc, char *argv[]);
 
 static command_t g_commands[] = {
     {"help", "显示帮助信息", cmd_help},
@@ -330,6 +339,11 @@ static command_t g_commands[] = {
     {"shutdown", "关机", cmd_shutdown},
     {"history", "显示命令历史", cmd_history},
     {"ls", "列出目录", cmd_list_dir},
+    {"bcache", "块缓存统计", cmd_bcache},
+    {"pcache", "文件页缓存统计", cmd_pcache},
+    {"sync", "回写磁盘缓存", cmd_sync},
+    {"blkdev", "块设备与请求合并统计", cmd_blkdev},
+    {"memtrace", "堆分配跟踪: memtrace [on|off|clear|<条数>]", cmd_memtrace},
 };
 
 static const int g_command_count = sizeof(g_commands) / sizeof(g_commands[0]);
@@ -625,6 +639,103 @@ void cmd_shutdown(int argc, char *argv[]) {
     shell_print("（关机功能需要实现）\n");
 }
 
+void cmd_bcache(int argc, char *argv[]) {
+    bcache_stats_t st;
+    bcache_get_stats(&st);
+
+    uint32_t total = st.hits + st.misses;
+    uint32_t hit_rate = total ? (uint32_t)((uint64_t)st.hits * 100 / total) : 0;
+
+    shell_printf("%s\n", "===== 块缓存 =====");
+    shell_printf("容量:     %u 扇区\n", BCACHE_ENTRIES);
+    shell_printf("已缓存:   %u 扇区 (脏: %u)\n", st.cached, st.dirty);
+    shell_printf("命中:     %u\n", st.hits);
+    shell_printf("未命中:   %u\n", st.misses);
+    shell_printf("命中率:   %u%%\n", hit_rate);
+    shell_printf("淘汰:     %u\n", st.evictions);
+    shell_printf("回写:     %u\n", st.writebacks);
+}
+
+void cmd_pcache(int argc, char *argv[]) {
+    pcache_stats_t st;
+    pcache_get_stats(&st);
+
+    uint32_t total = st.hits + st.misses;
+    uint32_t hit_rate = total ? (uint32_t)((uint64_t)st.hits * 100 / total) : 0;
+
+    shell_printf("%s\n", "===== 文件页缓存 =====");
+    shell_printf("容量:     %u 页\n", PCACHE_PAGES);
+    shell_printf("已缓存:   %u 页\n", st.cached);
+    shell_printf("命中:     %u\n", st.hits);
+    shell_printf("未命中:   %u\n", st.misses);
+    shell_printf("命中率:   %u%%\n", hit_rate);
+    shell_printf("读入页:   %u (含预读)\n", st.fills);
+    shell_printf("淘汰:     %u\n", st.evictions);
+}
+
+void cmd_sync(int argc, char *argv[]) {
+    if (bcache_sync() != 0) {
+        shell_print("回写失败\n");
+        return;
+    }
+    shell_print("缓存已回写\n");
+}
+
+#define MEMTRACE_SHOW_MAX 64
+
+void cmd_memtrace(int argc, char *argv[]) {
+    static mem_trace_rec_t recs[MEMTRACE_SHOW_MAX];
+    uint32_t want = 16;
+
+    if (argc >= 2) {
+        if (strcmp(argv[1], "on") == 0) {
+            mem_trace_enable(true);
+            shell_print("分配跟踪已开启\n");
+            return;
+        }
+        if (strcmp(argv[1], "off") == 0) {
+            mem_trace_enable(false);
+            shell_print("分配跟踪已关闭\n");
+            return;
+        }
+        if (strcmp(argv[1], "clear") == 0) {
+            mem_trace_clear();
+            shell_print("跟踪记录已清空\n");
+            return;
+        }
+        want = shell_strtoul(argv[1], NULL, 0);
+        if (want == 0) want = 16;
+    }
+    if (want > MEMTRACE_SHOW_MAX) want = MEMTRACE_SHOW_MAX;
+
+    uint32_t n = mem_trace_snapshot(recs, want);
+    shell_printf("跟踪%s，最近 %u 条记录:\n", mem_trace_is_enabled() ? "开启" : "关闭", n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        mem_trace_rec_t* r = &recs[i];
+        shell_printf("%u %s %u @%x%08x from %x%08x\n",
+                     (uint32_t)r->tick,
+                     r->op == MEM_TRACE_ALLOC ? "alloc" : "free ",
+                     r->size,
+                     (uint32_t)(r->ptr >> 32), (uint32_t)r->ptr,
+                     (uint32_t)(r->caller >> 32), (uint32_t)r->caller);
+    }
+}
+
+void cmd_blkdev(int argc, char *argv[]) {
+    blkdev_t* def = blkdev_get_default();
+
+    shell_printf("%s\n", "===== 块设备 =====");
+    for (int i = 0; i < blkdev_count(); i++) {
+        blkdev_t* dev = blkdev_get_index(i);
+        shell_printf("%s%s\n", dev->name, dev == def ? " (默认)" : "");
+        shell_printf("  提交: %u  合并: %u  下发: %u\n",
+                     dev->stats.submitted, dev->stats.merged, dev->stats.dispatched);
+        shell_printf("  中转: %u  错误: %u  在途: %u\n",
+                     dev->stats.bounced, dev->stats.errors, dev->inflight);
+    }
+}
+
 #define MAX_FILES 50
 
 void cmd_list_dir(int argc, char *argv[]){
@@ -1,11 +1,133 @@
 #include "vmm.h"
 #include "kernel.h"
+#include "cpu.h"
 
 extern boot_params_t kernel_params;
+extern char _end[];
+
+static pt_entry_t* kernel_pml4;
+
+typedef struct {
+    uint64_t base;
+    uint64_t end;
+    vmm_demand_check_t check;
+} vmm_demand_region_t;
+
+static vmm_demand_region_t demand_regions[VMM_MAX_DEMAND_REGIONS];
+static uint32_t demand_region_count;
+static volatile uint64_t demand_faults;
+
+#define CR4_PGE     (1ULL << 7)
+#define CR4_PCIDE   (1ULL << 17)
+#define CR0_CD      (1ULL << 30)
+
+// IA32_PAT：PA0 WB, PA1 WC, PA2 UC-, PA3 UC, PA4 WB, PA5 WT, PA6 UC-, PA7 UC
+// 与上电默认值相比只把 PA1 从 WT 改为 WC
+#define MSR_IA32_PAT    0x277
+#define PAT_VALUE       0x0007040600070106ULL
+
+// CPU 是否支持 1GB 大页 (CPUID 0x80000001 EDX bit 26)
+static bool vmm_has_1g_pages;
+// 全局页 (CPUID 1 EDX bit 13) 与 PCID (CPUID 1 ECX bit 17)
+static bool vmm_has_pge;
+static bool vmm_has_pcid;
+static bool vmm_has_pat;
+static bool pcid_enabled;
+// 高半区内核映射使用的附加标志，支持全局页时为 PTE_GLOBAL
+static uint64_t kernel_global;
+
+// PCID 分配器：位图分配，用尽时进入新一代并刷新全部 TLB，
+// 旧一代的地址空间在下次切换时重新分配
+static uint64_t asid_bitmap[VMM_MAX_ASID / 64];
+static uint64_t asid_generation;
+static uint32_t asid_next;
+static spinlock_t asid_lock;
+static vmm_space_t kernel_space;
+
+static inline uint64_t read_cr4(void) {
+    uint64_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void write_cr4(uint64_t cr4) {
+    asm volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+// 刷新所有 TLB 项，包括全局页和所有 PCID
+static void vmm_flush_tlb_all(void) {
+    uint64_t cr4 = read_cr4();
+    if (cr4 & CR4_PGE) {
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+    } else {
+        uint64_t cr3 = cpu_read_cr3() & ~CR3_NOFLUSH;
+        asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+    }
+}
+
+static void vmm_detect_features(void) {
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    vmm_has_pge = (edx & (1U << 13)) != 0;
+    vmm_has_pcid = (ecx & (1U << 17)) != 0;
+    vmm_has_pat = (edx & (1U << 16)) != 0;
+
+    eax = 0x80000000;
+    ecx = 0;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+
+    vmm_has_1g_pages = false;
+    if (eax >= 0x80000001) {
+        eax = 0x80000001;
+        ecx = 0;
+        asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+        vmm_has_1g_pages = (edx & (1U << 26)) != 0;
+    }
+}
+
+// 按 SDM 流程修改 PAT：关缓存、写回缓存后写 MSR，再刷新缓存和 TLB
+static void vmm_init_pat(void) {
+    if (!vmm_has_pat) return;
+
+    uint64_t flags = cpu_irq_save();
+    uint64_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %0, %%cr0" : : "r"(cr0 | CR0_CD) : "memory");
+    asm volatile("wbinvd" : : : "memory");
+
+    cpu_write_msr(MSR_IA32_PAT, PAT_VALUE);
+
+    asm volatile("wbinvd" : : : "memory");
+    asm volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
+    vmm_flush_tlb_all();
+    cpu_irq_restore(flags);
+}
+
+// 把大页项拆成下一级页表，保留原映射。page_size 为原大页大小
+static pt_entry_t* split_large(pt_entry_t* entry, uint64_t page_size) {
+    pt_entry_t* table = (pt_entry_t*)pmm_alloc_zpage();
+    if (!table) return NULL;
+
+    uint64_t base = *entry & PTE_ADDR_MASK;
+    uint64_t flags = *entry & ~PTE_ADDR_MASK;
+    uint64_t sub_size = page_size / 512;
+    // 拆到 4KB 时 PS 位不再有效
+    if (sub_size == PAGE_SIZE) flags &= ~PTE_HUGE;
+
+    for (int i = 0; i < 512; i++) {
+        table[i] = (base + i * sub_size) | flags;
+    }
+    *entry = (uint64_t)table | PTE_PRESENT | PTE_WRITABLE | (flags & PTE_USER);
+    return table;
+}
 
 // 辅助函数：获取下一级页表，不存在则分配
-static pt_entry_t* get_next_level(pt_entry_t* entry, uint64_t flags) {
+static pt_entry_t* get_next_level(pt_entry_t* entry, uint64_t flags, uint64_t page_size) {
     if (*entry & PTE_PRESENT) {
+        if (*entry & PTE_HUGE) {
+            return split_large(entry, page_size);
+        }
         return (pt_entry_t*)(*entry & PTE_ADDR_MASK);
     }
     
@@ -13,16 +135,17 @@ static pt_entry_t* get_next_level(pt_entry_t* entry, uint64_t flags) {
     void* new_table = pmm_alloc_zpage();
     if (!new_table) return NULL;
     
-    // 设置当前项指向新表，增加 Present 和 Writable 属性
-    *entry = (uint64_t)new_table | PTE_PRESENT | flags;
+    // 中间项只给 Present、Writable 和 User，缓存类型 (PWT/PCD)、NX、全局位等
+    // 只属于最后一级叶子项
+    *entry = (uint64_t)new_table | PTE_PRESENT | PTE_WRITABLE | (flags & PTE_USER);
     return (pt_entry_t*)new_table;
 }
 
 void vmm_map(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t flags) {
     // 逐级深入寻找或创建页表
-    pt_entry_t* pdpt = get_next_level(&pml4[PML4_IDX(virt)], flags);
-    pt_entry_t* pd   = get_next_level(&pdpt[PDPT_IDX(virt)], flags);
-    pt_entry_t* pt   = get_next_level(&pd[PD_IDX(virt)], flags);
+    pt_entry_t* pdpt = get_next_level(&pml4[PML4_IDX(virt)], flags, 0);
+    pt_entry_t* pd   = get_next_level(&pdpt[PDPT_IDX(virt)], flags, PAGE_SIZE_1G);
+    pt_entry_t* pt   = get_next_level(&pd[PD_IDX(virt)], flags, PAGE_SIZE_2M);
     
     // 在最后一级填写物理页地址
     pt[PT_IDX(virt)] = (phys & PTE_ADDR_MASK) | flags | PTE_PRESENT;
@@ -31,26 +154,411 @@ void vmm_map(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t flags) {
     asm volatile("invlpg (%0)" : : "r"(virt) : "memory");
 }
 
+// 可以在 entry 处放置大页：对齐、长度足够，且该项未指向已有的下级页表
+static bool can_map_large(pt_entry_t entry, uint64_t virt, uint64_t phys, uint64_t remain, uint64_t page_size) {
+    if ((virt | phys) & (page_size - 1)) return false;
+    if (remain < page_size) return false;
+    return !(entry & PTE_PRESENT) || (entry & PTE_HUGE);
+}
+
+// 映射一段连续区间，按对齐情况尽量使用 1GB / 2MB 大页，剩余部分用 4KB 页
+void vmm_map_large(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags) {
+    uint64_t end = virt + size;
+
+    while (virt < end) {
+        uint64_t remain = end - virt;
+        pt_entry_t* pdpt = get_next_level(&pml4[PML4_IDX(virt)], flags, 0);
+        if (!pdpt) return;
+
+        pt_entry_t* pdpte = &pdpt[PDPT_IDX(virt)];
+        if (vmm_has_1g_pages && can_map_large(*pdpte, virt, phys, remain, PAGE_SIZE_1G)) {
+            *pdpte = (phys & PTE_ADDR_MASK) | flags | PTE_PRESENT | PTE_HUGE;
+            asm volatile("invlpg (%0)" : : "r"(virt) : "memory");
+            virt += PAGE_SIZE_1G;
+            phys += PAGE_SIZE_1G;
+            continue;
+        }
+
+        pt_entry_t* pd = get_next_level(pdpte, flags, PAGE_SIZE_1G);
+        if (!pd) return;
+
+        pt_entry_t* pde = &pd[PD_IDX(virt)];
+        if (can_map_large(*pde, virt, phys, remain, PAGE_SIZE_2M)) {
+            *pde = (phys & PTE_ADDR_MASK) | flags | PTE_PRESENT | PTE_HUGE;
+            asm volatile("invlpg (%0)" : : "r"(virt) : "memory");
+            virt += PAGE_SIZE_2M;
+            phys += PAGE_SIZE_2M;
+            continue;
+        }
+
+        // 不满足大页条件，本 2MB 区域内剩余部分按 4KB 页批量映射
+        uint64_t chunk = PAGE_SIZE_2M - (virt & (PAGE_SIZE_2M - 1));
+        if (chunk > remain) chunk = remain;
+        if (vmm_map_range(pml4, virt, phys, chunk, flags) != 0) return;
+        virt += chunk;
+        phys += chunk;
+    }
+}
+
+// 低半区的 PML4 项若与内核 PML4 指向同一张页表，则被所有地址空间共享
+static bool vmm_lower_shared(pt_entry_t* pml4, uint64_t virt) {
+    if (!kernel_pml4) return false;
+    pt_entry_t e = pml4[PML4_IDX(virt)];
+    return (e & PTE_PRESENT) && (e & PTE_ADDR_MASK) == (kernel_pml4[PML4_IDX(virt)] & PTE_ADDR_MASK);
+}
+
+// 批量修改后统一刷新 TLB：页数少时逐页 invlpg，超过阈值直接重载 CR3。
+// 高半区页表由所有地址空间共享，且可能是全局页，无论当前 CR3 是谁都要刷新；
+// 共享的低半区页表同样要刷新。未开启 PCID 时只需清本 CPU 当前的项，
+// 私有且非当前的页表无需刷新。开启 PCID 后 invlpg 和重载 CR3 只清当前 PCID，
+// 共享低半区或其他空间的私有项可能留在别的 PCID 下，只能整体刷新
+static void vmm_flush_range(pt_entry_t* pml4, uint64_t virt, uint64_t pages) {
+    uint64_t cr3 = cpu_read_cr3();
+    uint64_t last = virt + (pages ? pages - 1 : 0) * PAGE_SIZE;
+    bool higher = virt >= PHYS_MAP_BASE;
+    bool lower_shared = !higher && (vmm_lower_shared(pml4, virt) || vmm_lower_shared(pml4, last));
+    bool current = (cr3 & PTE_ADDR_MASK) == (uint64_t)pml4;
+
+    if (pcid_enabled) {
+        if (higher ? !kernel_global : (lower_shared || !current)) {
+            vmm_flush_tlb_all();
+            return;
+        }
+    } else if (!higher && !lower_shared && !current) {
+        return;
+    }
+
+    if (pages > VMM_FLUSH_THRESHOLD) {
+        if (higher) {
+            vmm_flush_tlb_all();
+        } else {
+            // 重载 CR3 (清除 NOFLUSH 位) 刷新当前 PCID 的非全局项
+            cr3 &= ~CR3_NOFLUSH;
+            asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+        }
+        return;
+    }
+    for (uint64_t i = 0; i < pages; i++) {
+        asm volatile("invlpg (%0)" : : "r"(virt + i * PAGE_SIZE) : "memory");
+    }
+}
+
+// 映射一段连续区间 (4KB 粒度)。同一 2MB 区域内复用已找到的页表，
+// 只在跨越页表边界时重新逐级查找，结束后统一刷新 TLB
+int vmm_map_range(pt_entry_t* pml4, uint64_t virt, uint64_t phys, uint64_t size, uint64_t flags) {
+    uint64_t start = virt & ~(PAGE_SIZE - 1);
+    uint64_t end = (virt + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    phys &= ~(PAGE_SIZE - 1);
+
+    pt_entry_t* pt = NULL;
+    int ret = 0;
+
+    for (virt = start; virt < end; virt += PAGE_SIZE, phys += PAGE_SIZE) {
+        if (!pt || PT_IDX(virt) == 0) {
+            pt_entry_t* pdpt = get_next_level(&pml4[PML4_IDX(virt)], flags, 0);
+            pt_entry_t* pd = pdpt ? get_next_level(&pdpt[PDPT_IDX(virt)], flags, PAGE_SIZE_1G) : NULL;
+            pt = pd ? get_next_level(&pd[PD_IDX(virt)], flags, PAGE_SIZE_2M) : NULL;
+            if (!pt) {
+                ret = -1;
+                break;
+            }
+        }
+        pt[PT_IDX(virt)] = (phys & PTE_ADDR_MASK) | flags | PTE_PRESENT;
+    }
+
+    vmm_flush_range(pml4, start, (virt - start) / PAGE_SIZE);
+    return ret;
+}
+
+// 取消一段区间的映射，不释放物理页。被部分覆盖的大页先拆分；
+// 整个落在区间内的大页直接清除
+void vmm_unmap_range(pt_entry_t* pml4, uint64_t virt, uint64_t size) {
+    uint64_t start = virt & ~(PAGE_SIZE - 1);
+    uint64_t end = (virt + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    virt = start;
+    while (virt < end) {
+        uint64_t remain = end - virt;
+
+        pt_entry_t* pml4e = &pml4[PML4_IDX(virt)];
+        if (!(*pml4e & PTE_PRESENT)) {
+            virt = (virt + (1ULL << 39)) & ~((1ULL << 39) - 1);
+            continue;
+        }
+
+        pt_entry_t* pdpte = &((pt_entry_t*)(*pml4e & PTE_ADDR_MASK))[PDPT_IDX(virt)];
+        if (!(*pdpte & PTE_PRESENT)) {
+            virt = (virt + PAGE_SIZE_1G) & ~(PAGE_SIZE_1G - 1);
+            continue;
+        }
+        if (*pdpte & PTE_HUGE) {
+            if ((virt & (PAGE_SIZE_1G - 1)) == 0 && remain >= PAGE_SIZE_1G) {
+                *pdpte = 0;
+                virt += PAGE_SIZE_1G;
+                continue;
+            }
+            if (!split_large(pdpte, PAGE_SIZE_1G)) break;
+        }
+
+        pt_entry_t* pde = &((pt_entry_t*)(*pdpte & PTE_ADDR_MASK))[PD_IDX(virt)];
+        if (!(*pde & PTE_PRESENT)) {
+            virt = (virt + PAGE_SIZE_2M) & ~(PAGE_SIZE_2M - 1);
+            continue;
+        }
+        if (*pde & PTE_HUGE) {
+            if ((virt & (PAGE_SIZE_2M - 1)) == 0 && remain >= PAGE_SIZE_2M) {
+                *pde = 0;
+                virt += PAGE_SIZE_2M;
+                continue;
+            }
+            if (!split_large(pde, PAGE_SIZE_2M)) break;
+        }
+
+        // 清除本页表内落在区间中的所有项
+        pt_entry_t* pt = (pt_entry_t*)(*pde & PTE_ADDR_MASK);
+        do {
+            pt[PT_IDX(virt)] = 0;
+            virt += PAGE_SIZE;
+        } while (virt < end && PT_IDX(virt) != 0);
+    }
+
+    uint64_t last = virt < end ? virt : end;
+    vmm_flush_range(pml4, start, (last - start) / PAGE_SIZE);
+}
+
+// 查询虚拟地址对应的物理地址，未映射返回 0
+uint64_t vmm_translate(pt_entry_t* pml4, uint64_t virt) {
+    pt_entry_t e = pml4[PML4_IDX(virt)];
+    if (!(e & PTE_PRESENT)) return 0;
+
+    e = ((pt_entry_t*)(e & PTE_ADDR_MASK))[PDPT_IDX(virt)];
+    if (!(e & PTE_PRESENT)) return 0;
+    if (e & PTE_HUGE) return (e & PTE_ADDR_MASK) + (virt & (PAGE_SIZE_1G - 1));
+
+    e = ((pt_entry_t*)(e & PTE_ADDR_MASK))[PD_IDX(virt)];
+    if (!(e & PTE_PRESENT)) return 0;
+    if (e & PTE_HUGE) return (e & PTE_ADDR_MASK) + (virt & (PAGE_SIZE_2M - 1));
+
+    e = ((pt_entry_t*)(e & PTE_ADDR_MASK))[PT_IDX(virt)];
+    if (!(e & PTE_PRESENT)) return 0;
+    return (e & PTE_ADDR_MASK) + (virt & (PAGE_SIZE - 1));
+}
+
+// DMA 缓冲区的起始物理地址。按需堆中的页物理上不一定连续，
+// 区间跨越不连续的页时返回 0，调用者需改用中转缓冲
+uint64_t vmm_dma_addr(const volatile void* addr, uint64_t size) {
+    uint64_t v = (uint64_t)addr;
+    uint64_t start = virt_to_phys(addr);
+    if (v < KERNEL_HEAP_BASE || v - KERNEL_HEAP_BASE >= KERNEL_HEAP_SIZE) return start;
+    if (start == 0) return 0;
+
+    for (uint64_t page = (v & ~(PAGE_SIZE - 1)) + PAGE_SIZE; page < v + size; page += PAGE_SIZE) {
+        if (virt_to_phys((const volatile void*)page) != start + (page - v)) return 0;
+    }
+    return start;
+}
+
+// 登记一段按需分页的内核虚拟区间，缺页时自动分配并映射物理页
+int vmm_add_demand_region(uint64_t base, uint64_t size, vmm_demand_check_t check) {
+    if (!kernel_pml4 || demand_region_count >= VMM_MAX_DEMAND_REGIONS) return -1;
+
+    vmm_demand_region_t* r = &demand_regions[demand_region_count++];
+    r->base = base;
+    r->end = base + size;
+    r->check = check;
+    return 0;
+}
+
+uint64_t vmm_get_demand_faults(void) {
+    return demand_faults;
+}
+
+// 缺页处理 (向量 14)：按需区间内的不存在页就地分配，其余情况打印现场并停机
+static void vmm_page_fault(interrupt_frame_t* frame) {
+    uint64_t addr;
+    asm volatile("mov %%cr2, %0" : "=r"(addr));
+
+    if (!(frame->error_code & PF_PRESENT)) {
+        for (uint32_t i = 0; i < demand_region_count; i++) {
+            vmm_demand_region_t* r = &demand_regions[i];
+            if (addr < r->base || addr >= r->end) continue;
+            if (r->check && !r->check(addr)) break;
+
+            // 清零页：新的 kmalloc 不能看到之前释放页面的残留内容
+            void* page = pmm_alloc_zpage();
+            if (!page) {
+                serial_puts("VMM: out of memory resolving demand fault\n");
+                break;
+            }
+            vmm_map(kernel_pml4, addr & ~(PAGE_SIZE - 1), (uint64_t)page, PTE_WRITABLE | kernel_global);
+            demand_faults++;
+            return;
+        }
+    }
+
+    idt_dump_exception(frame);
+}
+
+pt_entry_t* vmm_get_kernel_pml4(void) {
+    return kernel_pml4;
+}
+
+bool vmm_pcid_enabled(void) {
+    return pcid_enabled;
+}
+
+vmm_space_t* vmm_kernel_space(void) {
+    return &kernel_space;
+}
+
+// 分配一个 PCID，调用者持有 asid_lock
+static uint16_t asid_alloc(void) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t n = 0; n < VMM_MAX_ASID - 1; n++) {
+            uint32_t id = asid_next + n;
+            if (id >= VMM_MAX_ASID) id -= VMM_MAX_ASID - 1;
+            if (asid_bitmap[id / 64] & (1ULL << (id % 64))) continue;
+
+            asid_bitmap[id / 64] |= 1ULL << (id % 64);
+            asid_next = id + 1 < VMM_MAX_ASID ? id + 1 : 1;
+            return (uint16_t)id;
+        }
+
+        // 全部用尽：进入新一代，清空位图并刷新全部 TLB
+        for (int i = 0; i < VMM_MAX_ASID / 64; i++) asid_bitmap[i] = 0;
+        asid_bitmap[0] = 1;
+        asid_generation++;
+        asid_next = 1;
+        vmm_flush_tlb_all();
+    }
+    return 0;
+}
+
+// 新建地址空间：复制内核 PML4 (高半区页表共享；低半区恒等映射暂时也共享，
+// 待驱动全部改用直接映射后去掉)
+int vmm_space_init(vmm_space_t* space) {
+    pt_entry_t* pml4 = (pt_entry_t*)pmm_alloc_zpage();
+    if (!pml4) return -1;
+
+    for (int i = 0; i < 512; i++) {
+        pml4[i] = kernel_pml4[i];
+    }
+    space->pml4 = pml4;
+    space->asid = 0;
+    space->asid_gen = 0;
+    return 0;
+}
+
+// 只释放 PML4 本身，共享的下级页表归内核所有
+void vmm_space_destroy(vmm_space_t* space) {
+    if (!space || space == &kernel_space || !space->pml4) return;
+
+    uint64_t flags = spin_lock_irqsave(&asid_lock);
+    if (space->asid && space->asid_gen == asid_generation) {
+        asid_bitmap[space->asid / 64] &= ~(1ULL << (space->asid % 64));
+    }
+    spin_unlock_irqrestore(&asid_lock, flags);
+
+    pmm_free_page(space->pml4);
+    space->pml4 = NULL;
+    space->asid = 0;
+}
+
+// 切换地址空间。PCID 有效且属于当前代时保留其 TLB 项；
+// 新分配的 PCID 可能残留旧空间的项，第一次切换时刷新
+void vmm_switch_space(vmm_space_t* space) {
+    if (!pcid_enabled) {
+        vmm_switch_table(space->pml4);
+        return;
+    }
+
+    uint64_t cr3 = (uint64_t)space->pml4;
+    if (space == &kernel_space) {
+        asm volatile("mov %0, %%cr3" : : "r"(cr3 | CR3_NOFLUSH) : "memory");
+        return;
+    }
+
+    bool flush = false;
+    uint64_t flags = spin_lock_irqsave(&asid_lock);
+    if (space->asid == 0 || space->asid_gen != asid_generation) {
+        space->asid = asid_alloc();
+        space->asid_gen = asid_generation;
+        flush = true;
+    }
+    cr3 |= space->asid;
+    if (!flush) cr3 |= CR3_NOFLUSH;
+    asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+    spin_unlock_irqrestore(&asid_lock, flags);
+}
+
 void vmm_switch_table(pt_entry_t* pml4) {
     // 加载 PML4 地址到 CR3 寄存器
     asm volatile("mov %0, %%cr3" : : "r"(pml4) : "memory");
 }
 
 void vmm_init() {
-    pt_entry_t* kernel_pml4 = (pt_entry_t*)pmm_alloc_zpage();
-    
-    // 标识映射前 1GB (包含内核代码、数据、栈)
-    for (uint64_t addr = 0; addr < 0x40000000; addr += PAGE_SIZE) {
-        vmm_map(kernel_pml4, addr, addr, PTE_WRITABLE);
+    vmm_detect_features();
+
+    demand_region_count = 0;
+    demand_faults = 0;
+    pcid_enabled = false;
+    kernel_global = vmm_has_pge ? PTE_GLOBAL : 0;
+
+    kernel_pml4 = (pt_entry_t*)pmm_alloc_zpage();
+    if (!kernel_pml4) return;
+
+    // 物理地址上限取内存映射中的最高地址，至少 4GB 以覆盖低端 MMIO (APIC、PCI BAR)
+    uint64_t top = 0x100000000ULL;
+    uint8_t* mmap = (uint8_t*)kernel_params.memory_map_addr;
+    uint64_t desc_count = kernel_params.memory_map_size / kernel_params.descriptor_size;
+    for (uint64_t i = 0; i < desc_count; i++) {
+        efi_mem_desc_t* d = (efi_mem_desc_t*)(mmap + i * kernel_params.descriptor_size);
+        uint64_t end = d->physical_start + d->number_of_pages * PAGE_SIZE;
+        if (end > top) top = end;
     }
+    top = (top + PAGE_SIZE_1G - 1) & ~(PAGE_SIZE_1G - 1);
 
-    // 显存区域标识映射 (防止开启分页后黑屏)
-    // TODO: 添加显存地址超过1GB的处理方案
-    uint64_t fb_base = kernel_params.framebuffer_addr;
-    uint64_t fb_size = kernel_params.framebuffer_size;
-    for (uint64_t addr = fb_base; addr < fb_base + fb_size; addr += PAGE_SIZE) {
-        vmm_map(kernel_pml4, addr, addr, PTE_WRITABLE);
+    // 恒等映射全部物理内存：PMM 页、DMA 缓冲区和 MMIO 仍按物理地址直接访问
+    vmm_map_large(kernel_pml4, 0, 0, top, PTE_WRITABLE);
+
+    // 高半区直接映射全部物理内存
+    vmm_map_large(kernel_pml4, PHYS_MAP_BASE, 0, top, PTE_WRITABLE | kernel_global);
+
+    // 内核映像：KERNEL_VMA 起映射物理 0 到 _end (含 BSS)
+    uint64_t kernel_size = ((uint64_t)_end - KERNEL_VMA + PAGE_SIZE_2M - 1) & ~(PAGE_SIZE_2M - 1);
+    vmm_map_large(kernel_pml4, KERNEL_VMA, 0, kernel_size, PTE_WRITABLE | kernel_global);
+
+    // 显存区域 (防止开启分页后黑屏)，可能位于内存上限之外。
+    // 覆盖上面的恒等/直接映射，两处别名都用写合并，避免同一物理页出现不同缓存类型
+    uint64_t fb_base = kernel_params.framebuffer_addr & ~(PAGE_SIZE - 1);
+    uint64_t fb_end = (kernel_params.framebuffer_addr + kernel_params.framebuffer_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint64_t fb_cache = vmm_has_pat ? PTE_WC : 0;
+    if (fb_end > fb_base) {
+        vmm_map_large(kernel_pml4, fb_base, fb_base, fb_end - fb_base, PTE_WRITABLE | fb_cache);
+        vmm_map_large(kernel_pml4, PHYS_MAP_BASE + fb_base, fb_base, fb_end - fb_base, PTE_WRITABLE | fb_cache | kernel_global);
     }
     
+    // 预先建立按需堆所在的 PML4 项，保证之后创建的地址空间共享同一下级页表
+    get_next_level(&kernel_pml4[PML4_IDX(KERNEL_HEAP_BASE)], PTE_WRITABLE, 0);
+
+    vmm_init_pat();
     vmm_switch_table(kernel_pml4);
+
+    // 开启全局页；PCID 要求开启时 CR3 低 12 位为 0，刚切换的内核页表满足
+    uint64_t cr4 = read_cr4();
+    if (vmm_has_pge) cr4 |= CR4_PGE;
+    if (vmm_has_pcid) cr4 |= CR4_PCIDE;
+    write_cr4(cr4);
+    pcid_enabled = vmm_has_pcid;
+
+    for (int i = 0; i < VMM_MAX_ASID / 64; i++) asid_bitmap[i] = 0;
+    asid_bitmap[0] = 1;
+    asid_generation = 1;
+    asid_next = 1;
+    asid_lock = (spinlock_t)SPINLOCK_INIT;
+    kernel_space.pml4 = kernel_pml4;
+    kernel_space.asid = 0;
+    kernel_space.asid_gen = asid_generation;
+
+    register_interrupt_handler(14, vmm_page_fault);
 }